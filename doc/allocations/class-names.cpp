@@ -0,0 +1,58 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <atomic>
+
+extern std::atomic<size_t> heapAllocationCount, heapReleaseCount; // from `count-allocations.cpp`
+
+TEST("Heap allocations when writing class names", class_name_allocations) {
+	using signalsmith::plot::Figure;
+
+	// A null stream, so that the only allocations come from the plot
+	struct NullBuffer : public std::streambuf {
+		int overflow(int c) override {
+			return c;
+		}
+		std::streamsize xsputn(const char *, std::streamsize n) override {
+			return n;
+		}
+	};
+	auto allocationsPerPoint = [&](int count) {
+		Figure figure;
+		auto &plot = figure(0, 0).plot(200, 200);
+		auto &dots = plot.line(1).drawFill();
+		auto &markers = plot.line(2);
+		for (int i = 0; i < count; ++i) {
+			dots.dot(i, i%7, 2);
+			markers.marker(i, i%5);
+		}
+		NullBuffer nullBuffer;
+		std::ostream nullStream(&nullBuffer);
+		figure.write(nullStream); // first write (with layout)
+		size_t start = heapAllocationCount;
+		figure.write(nullStream);
+		return heapAllocationCount - start;
+	};
+	size_t smallAllocations = allocationsPerPoint(1000), largeAllocations = allocationsPerPoint(2000);
+	double perPoint = (double(largeAllocations) - double(smallAllocations))/1000;
+	test.log("heap allocations:\t", perPoint, " per dot+marker");
+	TEST_ASSERT(perPoint == 0);
+}
+
+TEST("Replaced class-name tables are released", class_name_tables) {
+	using signalsmith::plot::PlotStyle;
+
+	PlotStyle style;
+	auto liveAfterChanges = [&](int count) {
+		size_t start = heapAllocationCount - heapReleaseCount;
+		for (int i = 0; i < count; ++i) {
+			style.markers.resize(1 + i%20, style.markers[0]);
+			if (style.markerId(i).empty()) test.log("unexpected");
+		}
+		return double(heapAllocationCount - heapReleaseCount) - double(start);
+	};
+	liveAfterChanges(100);
+	double small = liveAfterChanges(1000), large = liveAfterChanges(2000);
+	test.log("live allocations:\t", small, " after 1000 changes, ", large, " after 2000");
+	TEST_ASSERT(large <= small);
+}
@@ -0,0 +1,28 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/* Counts heap allocations by replacing the global `operator new`/`operator delete`.
+	This is only linked into the separate `allocations` executable, and is its own file so that the replacements aren't inlined into the tests. */
+std::atomic<size_t> heapAllocationCount(0), heapReleaseCount(0);
+void * operator new(size_t size) {
+	++heapAllocationCount;
+	if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc();
+}
+void * operator new[](size_t size) {
+	return operator new(size);
+}
+void operator delete(void *ptr) noexcept {
+	if (ptr) ++heapReleaseCount;
+	std::free(ptr);
+}
+void operator delete[](void *ptr) noexcept {
+	operator delete(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept {
+	operator delete(ptr);
+}
+void operator delete[](void *ptr, size_t) noexcept {
+	operator delete(ptr);
+}
@@ -0,0 +1,25 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <atomic>
+
+extern std::atomic<size_t> heapAllocationCount; // from `count-allocations.cpp`
+
+TEST("Heap allocations when checking the style version", style_version_allocations) {
+	using signalsmith::plot::PlotStyle;
+
+	PlotStyle style;
+	size_t version = style.version();
+	auto cached = style.cached(0, 0, []() {
+		return std::string("cached");
+	});
+
+	size_t start = heapAllocationCount;
+	for (int i = 0; i < 1000; ++i) {
+		if (style.version() != version) test.log("unexpected");
+		if (style.cached(0, 0, []() {return std::string();}) != cached) test.log("unexpected");
+	}
+	size_t allocations = heapAllocationCount - start;
+	test.log("heap allocations:\t", allocations, " for 1000 checks");
+	TEST_ASSERT(allocations == 0);
+}
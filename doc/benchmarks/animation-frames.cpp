@@ -0,0 +1,104 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <cmath>
+
+TEST("Line2D::toFrame() - contiguous frame storage", animation_frames) {
+	const size_t frameCount = 500, pointCount = 1000;
+
+	auto fill = [&](signalsmith::plot::Line2D &line, size_t f) {
+		for (size_t i = 0; i < pointCount; ++i) {
+			double x = i*0.01;
+			line.add(x, std::sin(x + f*0.01));
+		}
+		line.marker(0, 0).dot(1, 1, 2);
+	};
+
+	// Old approach: each frame copies the live vectors, and then clears them
+	struct CopiedFrame {
+		std::vector<double> x, y;
+		std::vector<size_t> moves;
+	};
+	BenchmarkRate copyTrial([&](int repeats, Timer &timer) {
+		for (int r = 0; r < repeats; ++r) {
+			std::vector<CopiedFrame> frames;
+			std::vector<double> x, y;
+			std::vector<size_t> moves;
+			for (size_t f = 0; f < frameCount; ++f) {
+				moves.push_back(0);
+				for (size_t i = 0; i < pointCount; ++i) {
+					double px = i*0.01;
+					x.push_back(px);
+					y.push_back(std::sin(px + f*0.01));
+				}
+				timer.start();
+				frames.push_back(CopiedFrame{x, y, moves});
+				x.clear();
+				y.clear();
+				moves.clear();
+				timer.stop();
+			}
+		}
+	});
+	BenchmarkRate frameTrial([&](int repeats, Timer &timer) {
+		for (int r = 0; r < repeats; ++r) {
+			signalsmith::plot::Plot2D plot;
+			auto &line = plot.line();
+			for (size_t f = 0; f < frameCount; ++f) {
+				fill(line, f);
+				timer.start();
+				line.toFrame(f);
+				timer.stop();
+			}
+		}
+	});
+	// Re-rendering the animation with the same line, so the storage has already grown
+	BenchmarkRate warmTrial([&](int repeats, Timer &timer) {
+		signalsmith::plot::Plot2D plot;
+		auto &line = plot.line();
+		for (int r = 0; r < repeats; ++r) {
+			line.clearFrames();
+			for (size_t f = 0; f < frameCount; ++f) {
+				fill(line, f);
+				timer.start();
+				line.toFrame(f);
+				timer.stop();
+			}
+		}
+	});
+	double copyRate = copyTrial.run(), frameRate = frameTrial.run(), warmRate = warmTrial.run();
+	test.log("capture:\tper-frame copies ", 1e6/copyRate/frameCount, " us/frame\tframe storage ", 1e6/frameRate/frameCount, " us/frame\t(warm) ", 1e6/warmRate/frameCount, " us/frame");
+
+	signalsmith::plot::Plot2D plot;
+	auto &line = plot.line();
+	for (size_t f = 0; f < frameCount; ++f) {
+		fill(line, f);
+		line.toFrame(f);
+	}
+	double dataBytes = frameCount*pointCount*2*sizeof(double);
+	test.log("memory:\t", line.memoryBytes()/dataBytes, "x the point data");
+}
+
+TEST("Animated dots starting after time 0", animation_frames_late_dots) {
+	signalsmith::plot::Figure figure;
+	auto &plot = figure(0, 0).plot(100, 100);
+	auto &line = plot.line().drawFill();
+	for (int f = 1; f <= 3; ++f) {
+		line.dot(f, f, 2);
+		figure.toFrame(f);
+	}
+	std::ostringstream stream;
+	figure.write(stream); // the blank (before the first frame) radius is "0"
+	std::string svg = stream.str();
+	TEST_ASSERT(svg.find("attributeName=\"r\"") != std::string::npos);
+	TEST_ASSERT(svg.find("values=\"0;") != std::string::npos);
+
+	// Null strings write nothing
+	std::ostringstream nullStream;
+	{
+		signalsmith::plot::SvgWriter svg(nullStream, signalsmith::plot::Bounds(0, 10, 0, 10), 100);
+		const char *null = nullptr;
+		svg.raw("a", null, "b").write(null);
+	}
+	TEST_ASSERT(nullStream.str() == "ab");
+}
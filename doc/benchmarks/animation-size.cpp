@@ -0,0 +1,49 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <cmath>
+
+TEST("Animated output size (merged frames, script deltas)", animation_size) {
+	const int frameCount = 200, pointCount = 1000;
+
+	// A scope-like animation: most frames hold still, and the rest only change a small window of points
+	auto makeFigure = [&](signalsmith::plot::Figure &figure) {
+		auto &plot = figure(0, 0).plot(400, 200);
+		auto &line = plot.line();
+		for (int f = 0; f < frameCount; ++f) {
+			int window = (f/4)*pointCount/(frameCount/4);
+			for (int i = 0; i < pointCount; ++i) {
+				double y = std::sin(i*0.02);
+				if (i >= window && i < window + 20) y += 0.5;
+				line.add(i, y);
+			}
+			line.toFrame(f*0.05);
+		}
+		line.loopFrame(frameCount*0.05);
+	};
+
+	auto write = [&](bool script) {
+		signalsmith::plot::Figure figure;
+		figure.style.scriptAnimation = script;
+		makeFigure(figure);
+		std::ostringstream stream;
+		figure.write(stream);
+		return stream.str();
+	};
+	double frameBytes;
+	{
+		signalsmith::plot::Figure figure;
+		auto &line = figure(0, 0).plot(400, 200).line();
+		for (int i = 0; i < pointCount; ++i) line.add(i, std::sin(i*0.02));
+		std::ostringstream stream;
+		figure.write(stream);
+		frameBytes = double(stream.str().size());
+	}
+	double fullBytes = frameBytes*frameCount; // roughly every frame written in full
+	std::string smil = write(false), script = write(true);
+	TEST_ASSERT(smil.find("<animate") != std::string::npos);
+	TEST_ASSERT(script.find("data-svg-plot-frames") != std::string::npos);
+	double smilBytes = double(smil.size()), scriptBytes = double(script.size());
+	test.log("SMIL (merged):\t", smilBytes, " bytes\t", smilBytes/fullBytes, "x full frames");
+	test.log("script deltas:\t", scriptBytes, " bytes\t", scriptBytes/fullBytes, "x full frames");
+}
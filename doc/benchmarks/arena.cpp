@@ -0,0 +1,111 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <cmath>
+#include <new>
+
+TEST("Arena allocation for Figure elements", arena) {
+	using signalsmith::plot::Grid;
+	using signalsmith::plot::Figure;
+	const int columns = 20, rows = 20, pointCount = 20;
+
+	std::vector<signalsmith::plot::Plot2D *> plots;
+	auto build = [&](Grid &grid) {
+		plots.clear();
+		for (int c = 0; c < columns; ++c) {
+			for (int r = 0; r < rows; ++r) {
+				auto &plot = grid(c, r).plot(60, 40);
+				plot.title("plot " + std::to_string(c) + "/" + std::to_string(r));
+				plot.x.major(0).minors(5, 10, 15).label("time");
+				plot.y.major(0).minors(-1, 1).label("value");
+				auto &line = plot.line();
+				for (int i = 0; i < pointCount; ++i) line.add(i, std::sin(i*0.3 + c + r));
+				line.label("line");
+				plot.legend(0, 1).line(line, "signal");
+				plots.push_back(&plot);
+			}
+		}
+	};
+	auto writeString = [&](Grid &grid) {
+		std::ostringstream stream;
+		grid.write(stream);
+		return stream.str();
+	};
+
+	// A plain `Grid` uses the heap, but gives the same output
+	{
+		Grid grid;
+		Figure figure;
+		build(grid);
+		build(figure);
+		TEST_ASSERT(!grid.arena());
+		TEST_ASSERT(figure.arena());
+		std::string heapSvg = writeString(grid);
+		TEST_ASSERT(writeString(figure) == heapSvg);
+		size_t allocations = figure.lastWrite.allocations;
+		TEST_ASSERT(allocations >= size_t(columns*rows*7)); // labels for ticks, axes, titles and legends
+		test.log("first write:\t", allocations, " elements from ", figure.lastWrite.heapAllocations, " heap blocks");
+
+		// Re-laying-out after a change re-uses the freed labels' memory
+		plots[0]->title("changed");
+		plots[5]->x.label("changed");
+		writeString(figure);
+		TEST_ASSERT(figure.lastWrite.allocations > 0);
+		TEST_ASSERT(figure.lastWrite.heapAllocations == 0);
+		test.log("after changes:\t", figure.lastWrite.allocations, " elements from ", figure.lastWrite.heapAllocations, " heap blocks");
+		test.log("arena:\t", figure.arena()->allocations(), " elements in ", figure.arena()->memoryBytes()/1024, " KB");
+	}
+
+	// User subclasses can still use any form of `new`, and heap-allocated children can be added to arena-allocated elements
+	{
+		struct Custom : public signalsmith::plot::SvgDrawable {
+			int *destroyed;
+			Custom(int *destroyed) : destroyed(destroyed) {}
+			~Custom() {
+				++*destroyed;
+			}
+		};
+		int destroyed = 0;
+		alignas(Custom) char buffer[sizeof(Custom)];
+		Custom *placed = new (buffer) Custom(&destroyed);
+		placed->~Custom();
+		Custom *nothrow = new (std::nothrow) Custom(&destroyed);
+		delete nothrow;
+		TEST_ASSERT(destroyed == 2);
+		{
+			Figure figure;
+			auto &plot = figure(0, 0).plot(60, 40);
+			plot.addChild(new Custom(&destroyed)); // heap
+			plot.addChild(plot.create<Custom>(&destroyed)); // arena
+			TEST_ASSERT(plot.arena() == figure.arena());
+			writeString(figure);
+		}
+		TEST_ASSERT(destroyed == 4);
+	}
+
+	// Create, write and destroy
+	BenchmarkRate heapTrial([&](int repeats, Timer &timer) {
+		for (int r = 0; r < repeats; ++r) {
+			timer.start();
+			{
+				Grid grid;
+				build(grid);
+				writeString(grid);
+			}
+			timer.stop();
+		}
+	});
+	BenchmarkRate arenaTrial([&](int repeats, Timer &timer) {
+		for (int r = 0; r < repeats; ++r) {
+			timer.start();
+			{
+				Figure figure;
+				build(figure);
+				writeString(figure);
+			}
+			timer.stop();
+		}
+	});
+	double heapRate = heapTrial.run(), arenaRate = arenaTrial.run();
+	test.log("build/write/destroy:\theap ", 1e3/heapRate, " ms\tarena ", 1e3/arenaRate, " ms");
+}
@@ -0,0 +1,70 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <random>
+
+TEST("Axis::map() - batch vs std::function per value", axis_map_batch) {
+	const size_t length = 1000000;
+	std::vector<double> values(length), output(length);
+	std::mt19937 randomEngine(12345);
+	std::uniform_real_distribution<double> dist(1, 1000);
+	for (auto &v : values) v = dist(randomEngine);
+
+	auto compare = [&](const char *name, signalsmith::plot::Axis &knownAxis, signalsmith::plot::Axis &customAxis) {
+		BenchmarkRate functionTrial([&](int repeats, Timer &timer) {
+			timer.start();
+			for (int r = 0; r < repeats; ++r) {
+				for (size_t i = 0; i < length; ++i) output[i] = customAxis.map(values[i]);
+			}
+			timer.stop();
+		});
+		BenchmarkRate batchTrial([&](int repeats, Timer &timer) {
+			timer.start();
+			for (int r = 0; r < repeats; ++r) knownAxis.map(values.data(), output.data(), length);
+			timer.stop();
+		});
+		double functionRate = functionTrial.run(), batchRate = batchTrial.run();
+		test.log(name, ":\tstd::function ", 1e9/functionRate/length, " ns/value\tbatch ", 1e9/batchRate/length, " ns/value\tspeed-up ", batchRate/functionRate);
+
+		std::vector<double> batch(length);
+		knownAxis.map(values.data(), batch.data(), length);
+		for (size_t i = 0; i < length; ++i) {
+			TEST_ASSERT(std::abs(batch[i] - customAxis.map(values[i])) < 1e-9);
+		}
+	};
+
+	signalsmith::plot::Axis linear(0, 500), linearCustom(0, 500);
+	linear.linear(1, 1000);
+	double low = 1, high = 1000;
+	linearCustom.range([=](double v) {
+		return (v - low)/(high - low);
+	});
+	compare("linear", linear, linearCustom);
+
+	signalsmith::plot::Axis log(0, 500), logCustom(0, 500);
+	log.range(std::log, 1, 1000);
+	logCustom.range(std::function<double(double)>(static_cast<double(*)(double)>(std::log)), 1, 1000);
+	compare("log", log, logCustom);
+}
+
+TEST("Axis::range(std::cbrt) with negative values", axis_map_cbrt) {
+	using signalsmith::plot::Axis;
+	Axis axis(0, 100), custom(0, 100);
+	axis.range(std::cbrt, -8, 8);
+	custom.range(std::function<double(double)>([](double v) {
+		return std::cbrt(v);
+	}), -8, 8);
+	TEST_ASSERT(axis.map(-8) == 0);
+	TEST_ASSERT(axis.map(8) == 100);
+	TEST_ASSERT(std::abs(axis.map(0) - 50) < 1e-9);
+
+	std::vector<double> values = {-8, -4, -1, -0.001, 0, 0.5, 3, 8};
+	std::vector<double> batch(values.size());
+	axis.map(values.data(), batch.data(), values.size());
+	for (size_t i = 0; i < values.size(); ++i) {
+		double expected = custom.map(values[i]);
+		TEST_ASSERT(std::isfinite(axis.map(values[i])));
+		TEST_ASSERT(std::abs(axis.map(values[i]) - expected) < 1e-9);
+		TEST_ASSERT(std::abs(batch[i] - expected) < 1e-9);
+	}
+}
@@ -0,0 +1,45 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+TEST("Class names from PlotStyle", class_names) {
+	using signalsmith::plot::PlotStyle;
+	using signalsmith::plot::Figure;
+
+	{
+		PlotStyle style;
+		TEST_ASSERT(style.strokeClass(0) == "svg-plot-s0");
+		TEST_ASSERT(style.fillClass(7) == "svg-plot-f1");
+		TEST_ASSERT(style.textClass(-1) == "svg-plot-t");
+		TEST_ASSERT(style.dashClass(8) == "svg-plot-d1");
+		TEST_ASSERT(style.hatchClass(5) == "svg-plot-h1");
+		TEST_ASSERT(style.markerId(-2) == "svg-plot-marker2");
+		// The same strings are returned each time
+		TEST_ASSERT(&style.strokeClass(3) == &style.strokeClass(9));
+		// Rebuilt when the number of colours changes
+		style.colours.push_back("#000");
+		TEST_ASSERT(style.strokeClass(6) == "svg-plot-s6");
+		style.colours.resize(0);
+		TEST_ASSERT(style.strokeClass(6) == "svg-plot-s");
+		// Copies get their own tables
+		PlotStyle copy = style;
+		TEST_ASSERT(copy.strokeClass(6) == "svg-plot-s");
+		copy.colours = {"#F00", "#0F0"};
+		TEST_ASSERT(copy.strokeClass(3) == "svg-plot-s1");
+		TEST_ASSERT(style.strokeClass(3) == "svg-plot-s");
+	}
+
+	PlotStyle style;
+	BenchmarkRate lookupTrial([&](int repeats, Timer &timer) {
+		size_t total = 0;
+		timer.start();
+		for (int r = 0; r < repeats; ++r) {
+			for (int i = 0; i < 100; ++i) {
+				total += style.strokeClass(i).size() + style.fillClass(i).size() + style.markerId(i).size();
+			}
+		}
+		timer.stop();
+		if (total == 0) test.log("unexpected");
+	});
+	double lookupRate = lookupTrial.run();
+	test.log("lookup:\t", 1e9/lookupRate/300, " ns per class name");
+}
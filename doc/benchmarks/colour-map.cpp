@@ -0,0 +1,106 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <random>
+
+TEST("PlotStyle::cmap lookup table vs per-call evaluation", colour_map_lut) {
+	using signalsmith::plot::PlotStyle;
+	const size_t count = 100000;
+	std::mt19937 randomEngine(12345);
+	std::uniform_real_distribution<double> dist(0, 1);
+	std::vector<double> values(count);
+	for (auto &v : values) v = dist(randomEngine);
+
+	PlotStyle style;
+	// Old approach: evaluate the function and hex-format the result, for every dot
+	BenchmarkRate functionTrial([&](int repeats, Timer &timer) {
+		static constexpr const char *hexChars = "0123456789ABCDEF";
+		char str[10];
+		size_t checksum = 0;
+		timer.start();
+		for (int r = 0; r < repeats; ++r) {
+			for (auto v : values) {
+				double rgba[4] = {v, v, v, 1};
+				style.cmap(v, rgba);
+				str[0] = '#';
+				for (size_t c = 0; c < 3; ++c) {
+					uint8_t byte = (uint8_t)std::round(255*std::max(0.0, std::min(1.0, rgba[c])));
+					str[c*2 + 1] = hexChars[byte>>4];
+					str[c*2 + 2] = hexChars[byte&15];
+				}
+				checksum += str[1];
+			}
+		}
+		timer.stop();
+		TEST_ASSERT(checksum > 0);
+	});
+	BenchmarkRate tableTrial([&](int repeats, Timer &timer) {
+		size_t checksum = 0;
+		timer.start();
+		for (int r = 0; r < repeats; ++r) {
+			for (auto v : values) checksum += style.cmap.hex(v)[1];
+		}
+		timer.stop();
+		TEST_ASSERT(checksum > 0);
+	});
+	double functionRate = functionTrial.run(), tableRate = tableTrial.run();
+	test.log("per call:\t", 1e9/functionRate/count, " ns/value\ttable ", 1e9/tableRate/count, " ns/value\tspeed-up ", tableRate/functionRate);
+
+	// The table should match the function to within rounding of the input value
+	for (size_t i = 0; i <= 255; ++i) {
+		double v = i/255.0, rgba[4] = {v, v, v, 1};
+		PlotStyle::defaultCMap(v, rgba);
+		for (int c = 0; c < 4; ++c) {
+			TEST_ASSERT(style.cmap.rgba8(v)[c] == uint8_t(std::round(255*std::max(0.0, std::min(1.0, rgba[c])))));
+		}
+	}
+	// Assigning a new function rebuilds the table, but copies keep their own
+	PlotStyle copy = style;
+	style.cmap = [](double v, double *rgba) {
+		rgba[0] = v;
+		rgba[1] = rgba[2] = 0;
+	};
+	TEST_ASSERT(std::string(style.cmap.hex(1)) == "#FF0000");
+	TEST_ASSERT(std::string(copy.cmap.hex(1)) == "#FFFFFF");
+}
+
+TEST("PlotStyle::cmap out-of-range values and exact dot colours", colour_map_exact) {
+	using signalsmith::plot::PlotStyle;
+	PlotStyle style;
+	TEST_ASSERT(style.cmap.index(std::nan("")) == 0);
+	TEST_ASSERT(style.cmap.index(-1) == 0);
+	TEST_ASSERT(style.cmap.index(2) == size_t(style.cmap.steps()));
+
+	// Exact hex matches the per-call evaluation, including values between table entries
+	char hex[10];
+	for (size_t i = 0; i <= 10000; ++i) {
+		double v = i/10000.0, rgba[4] = {v, v, v, 1};
+		style.cmap(v, rgba);
+		char expected[10] = "#";
+		for (size_t c = 0; c < 3; ++c) {
+			uint8_t byte = (uint8_t)std::round(255*std::max(0.0, std::min(1.0, rgba[c])));
+			expected[c*2 + 1] = "0123456789ABCDEF"[byte>>4];
+			expected[c*2 + 2] = "0123456789ABCDEF"[byte&15];
+		}
+		style.cmap.exactHex(v, hex);
+		TEST_ASSERT(std::string(hex) == expected);
+	}
+
+	// Dots in the SVG use the exact value, where that differs from the nearest table entry
+	double c = 0.5, mapped = 0.5;
+	for (size_t i = 0; i <= 10000; ++i) {
+		c = i/10000.0;
+		mapped = 0.5 + (c - 0.5)*style.dotCmapDepth;
+		style.cmap.exactHex(mapped, hex);
+		if (std::string(hex) != style.cmap.hex(mapped)) break;
+	}
+	TEST_ASSERT(std::string(hex) != style.cmap.hex(mapped));
+	signalsmith::plot::Figure figure;
+	auto &plot = figure(0, 0).plot(100, 100);
+	plot.x.linear(0, 1);
+	plot.y.linear(0, 1);
+	plot.line(-1).dot(0.5, 0.5, 5, c);
+	std::ostringstream svg;
+	figure.write(svg);
+	TEST_ASSERT(svg.str().find(std::string("stroke:") + hex + "\"") != std::string::npos);
+}
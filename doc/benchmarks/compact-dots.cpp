@@ -0,0 +1,44 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <random>
+
+TEST("Compact dots (PlotStyle::compactDots)", compact_dots) {
+	const int dotCount = 100000;
+	signalsmith::plot::Figure figure;
+	auto &plot = figure(0, 0).plot(400, 400);
+	std::mt19937 randomEngine(12345);
+	std::normal_distribution<double> position(0, 1);
+	std::uniform_real_distribution<double> colour(0, 1);
+	auto &plain = plot.line(0).drawFill();
+	auto &coloured = plot.line(1).drawFill();
+	for (int i = 0; i < dotCount/2; ++i) {
+		plain.dot(position(randomEngine), position(randomEngine), 2);
+		coloured.dot(position(randomEngine), position(randomEngine), 3, colour(randomEngine));
+	}
+
+	auto runWrite = [&](bool compact, int repeats, Timer &timer) {
+		figure.style.compactDots = compact;
+		size_t bytes = 0;
+		for (int r = 0; r < repeats; ++r) {
+			std::ostringstream stream;
+			timer.start();
+			figure.write(stream);
+			timer.stop();
+			bytes = stream.str().size();
+		}
+		return bytes;
+	};
+	size_t circleBytes = 0, compactBytes = 0;
+	BenchmarkRate circleTrial([&](int repeats, Timer &timer) {
+		circleBytes = runWrite(false, repeats, timer);
+	});
+	BenchmarkRate compactTrial([&](int repeats, Timer &timer) {
+		compactBytes = runWrite(true, repeats, timer);
+	});
+	double circleRate = circleTrial.run(), compactRate = compactTrial.run();
+	test.log("<circle>s:\t", double(circleBytes)/dotCount, " bytes/dot\t", 1e9/circleRate/dotCount, " ns/dot");
+	test.log("compact:\t", double(compactBytes)/dotCount, " bytes/dot\t", 1e9/compactRate/dotCount, " ns/dot");
+	test.log("size ratio:\t", double(circleBytes)/compactBytes, "\tspeed-up:\t", compactRate/circleRate);
+	TEST_ASSERT(compactBytes*5 < circleBytes);
+}
@@ -0,0 +1,53 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+TEST("Grid cell lookup (100x100 small multiples)", grid_lookup) {
+	using signalsmith::plot::Grid;
+	const int columns = 100, rows = 100;
+
+	// Cells are found again, including negative coordinates
+	{
+		Grid grid;
+		Grid &a = grid(-1, 0), &b = grid(0, -1), &c = grid(0, 0), &d = grid(-1, -1);
+		TEST_ASSERT(&a != &b && &a != &c && &a != &d && &b != &c && &b != &d && &c != &d);
+		TEST_ASSERT(&grid(-1, 0) == &a);
+		TEST_ASSERT(&grid(0, -1) == &b);
+		TEST_ASSERT(&grid(0, 0) == &c);
+		TEST_ASSERT(&grid(-1, -1) == &d);
+		TEST_ASSERT(grid.columns() == 1 && grid.rows() == 1);
+	}
+	// Filling in a different order gives the same layout, but cells are output in the order they were created
+	{
+		Grid byRow, byColumn;
+		for (int r = 0; r < 3; ++r) {
+			for (int c = 0; c < 3; ++c) byRow(c, r).plot(20, 20).title(std::to_string(c) + "/" + std::to_string(r));
+		}
+		for (int c = 0; c < 3; ++c) {
+			for (int r = 0; r < 3; ++r) byColumn(c, r).plot(20, 20).title(std::to_string(c) + "/" + std::to_string(r));
+		}
+		std::ostringstream rowStream, columnStream;
+		byRow.write(rowStream);
+		byColumn.write(columnStream);
+		std::string rowSvg = rowStream.str(), columnSvg = columnStream.str();
+		TEST_ASSERT(rowSvg.size() == columnSvg.size());
+		TEST_ASSERT(rowSvg.find(">1/0<") < rowSvg.find(">0/1<"));
+		TEST_ASSERT(columnSvg.find(">0/1<") < columnSvg.find(">1/0<"));
+	}
+
+	BenchmarkRate fillTrial([&](int repeats, Timer &timer) {
+		for (int r = 0; r < repeats; ++r) {
+			Grid grid;
+			timer.start();
+			for (int c = 0; c < columns; ++c) {
+				for (int r = 0; r < rows; ++r) grid(c, r);
+			}
+			// Access every cell again (e.g. to add data)
+			for (int c = 0; c < columns; ++c) {
+				for (int r = 0; r < rows; ++r) grid(c, r);
+			}
+			timer.stop();
+		}
+	});
+	double fillRate = fillTrial.run();
+	test.log("create + access ", columns*rows, " cells:\t", 1e3/fillRate, " ms");
+}
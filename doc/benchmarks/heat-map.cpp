@@ -0,0 +1,40 @@
+#include "../util/test/tests.h"
+
+// `HeatMap`/`HeatMap32` can be forward-declared, before the header is included
+namespace signalsmith { namespace plot {
+	struct HeatMap;
+	struct HeatMap32;
+}}
+double firstValue(const signalsmith::plot::HeatMap &map);
+
+#include "../../heatmap.h"
+
+double firstValue(const signalsmith::plot::HeatMap &map) {
+	return map(0, 0);
+}
+
+TEST("HeatMap::assign() sizes", heat_map_assign) {
+	using signalsmith::plot::HeatMap;
+	using signalsmith::plot::HeatMap32;
+
+	HeatMap map(3, 2);
+	// Containers copy at most their own size
+	std::vector<float> short3 = {1, 2, 3};
+	map.assign(short3);
+	TEST_ASSERT(firstValue(map) == 1 && map(2, 0) == 3 && map(0, 1) == 0);
+	std::vector<int> long8 = {1, 2, 3, 4, 5, 6, 7, 8};
+	map.assign(long8);
+	TEST_ASSERT(map(2, 1) == 6);
+	// Pointers need an explicit count
+	double values[] = {10, 20, 30, 40, 50, 60};
+	map.assign(values + 1, 2);
+	TEST_ASSERT(map(0, 0) == 20 && map(1, 0) == 30 && map(2, 0) == 3);
+	// Fixed-size arrays use their size
+	map.assign(values);
+	TEST_ASSERT(map(2, 1) == 60);
+
+	HeatMap32 map32(2, 2);
+	map32.assign(values, 4);
+	map32.flipY();
+	TEST_ASSERT(map32(0, 0) == 30.0f && map32(1, 1) == 20.0f);
+}
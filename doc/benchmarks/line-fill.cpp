@@ -0,0 +1,89 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <random>
+
+TEST("Line2D::addArray() - bulk auto-scale vs per-value", line_fill_autoscale) {
+	const size_t length = 1000000;
+	std::vector<double> x(length), y(length);
+	std::mt19937 randomEngine(12345);
+	std::uniform_real_distribution<double> dist(-100, 100);
+	for (size_t i = 0; i < length; ++i) {
+		x[i] = i;
+		y[i] = dist(randomEngine);
+	}
+
+	// Registering each value with the axes, vs. the reduction used by `.addArray()`
+	BenchmarkRate perValueTrial([&](int repeats, Timer &timer) {
+		signalsmith::plot::Axis axisX(0, 100), axisY(0, 100);
+		timer.start();
+		for (int r = 0; r < repeats; ++r) {
+			for (size_t i = 0; i < length; ++i) {
+				axisX.autoValue(x[i]);
+				axisY.autoValue(y[i]);
+			}
+		}
+		timer.stop();
+	});
+	BenchmarkRate reductionTrial([&](int repeats, Timer &timer) {
+		signalsmith::plot::Axis::AutoRange rangeX, rangeY;
+		timer.start();
+		for (int r = 0; r < repeats; ++r) {
+			rangeX.add(x.data(), length);
+			rangeY.add(y.data(), length);
+		}
+		timer.stop();
+		TEST_ASSERT(rangeX.min == 0 && rangeX.max == length - 1);
+	});
+	double perValueRate = perValueTrial.run(), reductionRate = reductionTrial.run();
+	test.log("auto-scale:\tper-value ", 1e9/perValueRate/length, " ns/point\treduction ", 1e9/reductionRate/length, " ns/point\tspeed-up ", reductionRate/perValueRate);
+
+	// Whole fill (including allocation) compared to copying into fresh vectors
+	BenchmarkRate copyTrial([&](int repeats, Timer &timer) {
+		for (int r = 0; r < repeats; ++r) {
+			timer.start();
+			std::vector<double> copyX(x), copyY(y);
+			timer.stop();
+		}
+	});
+	BenchmarkRate fillTrial([&](int repeats, Timer &timer) {
+		for (int r = 0; r < repeats; ++r) {
+			signalsmith::plot::Plot2D plot;
+			auto &line = plot.line();
+			timer.start();
+			line.addArray(x, y);
+			timer.stop();
+		}
+	});
+	double copyRate = copyTrial.run(), fillRate = fillTrial.run();
+	test.log("fill:\tvector copy ", 1e9/copyRate/length, " ns/point\taddArray() ", 1e9/fillRate/length, " ns/point");
+
+	// Same auto-scale range either way
+	signalsmith::plot::Plot2D plot;
+	plot.line().addArray(x, y);
+	signalsmith::plot::Axis expectedY(plot.y.drawLow, plot.y.drawHigh);
+	for (auto v : y) expectedY.autoValue(v);
+	plot.y.autoSetup();
+	expectedY.autoSetup();
+	TEST_ASSERT(plot.y.map(0) == expectedY.map(0));
+	TEST_ASSERT(plot.y.map(1) == expectedY.map(1));
+}
+
+TEST("Auto-scale from a line using another plot's axes", line_other_axes) {
+	signalsmith::plot::Plot2D keep;
+	keep.line().add(0, 0).add(1, 1);
+	{
+		// This line (and its plot) is destroyed before `keep` is written, but its values still count
+		signalsmith::plot::Plot2D other;
+		other.line(keep.x, keep.y).add(0, 0).add(10, 10);
+	}
+	std::ostringstream stream;
+	keep.write(stream);
+
+	signalsmith::plot::Plot2D expected;
+	expected.line().add(0, 0).add(1, 1).add(10, 10);
+	std::ostringstream expectedStream;
+	expected.write(expectedStream);
+	TEST_ASSERT(keep.y.map(10) == expected.y.map(10));
+	TEST_ASSERT(keep.x.map(10) == expected.x.map(10));
+}
@@ -0,0 +1,74 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <random>
+#include <chrono>
+
+TEST("Line2D::nearest() - indexed vs linear scan", line_nearest) {
+	const size_t length = 1000000, queries = 1000;
+	std::mt19937 randomEngine(12345);
+	std::uniform_real_distribution<double> dist(0, 1000);
+	std::vector<double> queryX(queries), queryY(queries);
+	for (size_t q = 0; q < queries; ++q) {
+		queryX[q] = dist(randomEngine);
+		queryY[q] = dist(randomEngine);
+	}
+
+	auto compare = [&](const char *name, const std::vector<double> &x, const std::vector<double> &y) {
+		signalsmith::plot::Plot2D plot;
+		auto &line = plot.line();
+		line.addArray(x, y);
+
+		// The closest in x (earliest if there's a tie), as `.label(xIsh, ...)` used to find it
+		auto linearX = [&](double xIsh) {
+			size_t closest = 0;
+			double closestError = -1;
+			for (size_t i = 0; i < x.size(); ++i) {
+				if (closestError < 0 || closestError > std::abs(x[i] - xIsh)) {
+					closest = i;
+					closestError = std::abs(x[i] - xIsh);
+				}
+			}
+			return closest;
+		};
+		std::vector<size_t> expected(queries);
+		auto startTime = std::chrono::steady_clock::now();
+		for (size_t q = 0; q < queries; ++q) expected[q] = linearX(queryX[q]);
+		auto linearTime = std::chrono::steady_clock::now();
+		std::vector<signalsmith::plot::Point2D> found(queries);
+		for (size_t q = 0; q < queries; ++q) found[q] = line.nearest(queryX[q]);
+		auto indexedTime = std::chrono::steady_clock::now();
+		double linearMs = std::chrono::duration<double, std::milli>(linearTime - startTime).count();
+		double indexedMs = std::chrono::duration<double, std::milli>(indexedTime - linearTime).count();
+		for (size_t q = 0; q < queries; ++q) {
+			TEST_ASSERT(found[q].x == x[expected[q]] && found[q].y == y[expected[q]]);
+		}
+		test.log(name, ":\tlinear ", linearMs/queries, " ms/query\tindexed ", indexedMs/queries, " ms/query (including first-use index)");
+
+		// Nearest (x, y), relative to the data extent
+		double minX = *std::min_element(x.begin(), x.end()), maxX = *std::max_element(x.begin(), x.end());
+		double minY = *std::min_element(y.begin(), y.end()), maxY = *std::max_element(y.begin(), y.end());
+		for (size_t q = 0; q < 20; ++q) {
+			double bestDist2 = INFINITY;
+			size_t best = 0;
+			for (size_t i = 0; i < x.size(); ++i) {
+				double dx = (x[i] - queryX[q])/(maxX - minX), dy = (y[i] - queryY[q])/(maxY - minY);
+				if (dx*dx + dy*dy < bestDist2) {
+					bestDist2 = dx*dx + dy*dy;
+					best = i;
+				}
+			}
+			auto point = line.nearest(queryX[q], queryY[q]);
+			TEST_ASSERT(point.x == x[best] && point.y == y[best]);
+		}
+	};
+
+	std::vector<double> x(length), y(length);
+	for (size_t i = 0; i < length; ++i) {
+		x[i] = std::round(i*1000.0/length);
+		y[i] = dist(randomEngine);
+	}
+	compare("ascending", x, y);
+	for (auto &v : x) v = std::round(dist(randomEngine));
+	compare("unsorted", x, y);
+}
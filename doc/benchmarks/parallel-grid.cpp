@@ -0,0 +1,60 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <random>
+
+TEST("Parallel Grid writing (20x20 small multiples)", parallel_grid) {
+	signalsmith::plot::Figure figure;
+	std::mt19937 randomEngine(12345);
+	std::uniform_real_distribution<double> noise(-1, 1);
+	for (int column = 0; column < 20; ++column) {
+		for (int row = 0; row < 20; ++row) {
+			auto &plot = figure(column, row).plot(120, 80);
+			plot.x.major(0);
+			plot.y.major(0);
+			plot.title("cell");
+			auto &line = plot.line();
+			for (int i = 0; i < 20000; ++i) {
+				line.add(i, std::sin(i*0.001*(column + 1)) + 0.1*noise(randomEngine));
+			}
+		}
+	}
+
+	auto writeString = [&](int threads) {
+		figure.parallel(threads);
+		std::ostringstream stream;
+		figure.write(stream);
+		return stream.str();
+	};
+	// A fixed number of threads, so the parallel path is checked even on a single core
+	std::string expected = writeString(1);
+	TEST_ASSERT(expected.size() > 0);
+	TEST_ASSERT(writeString(4) == expected);
+	TEST_ASSERT(writeString(3) == expected); // cells don't divide evenly between threads
+
+	// One thread per core, for timing
+	std::string serial, parallel;
+	auto runWrite = [&](int threads, int repeats, Timer &timer, std::string &result) {
+		figure.parallel(threads);
+		timer.start();
+		for (int r = 0; r < repeats; ++r) {
+			std::ostringstream stream;
+			figure.write(stream);
+			result = stream.str();
+		}
+		timer.stop();
+	};
+	BenchmarkRate serialTrial([&](int repeats, Timer &timer) {
+		runWrite(1, repeats, timer, serial);
+	});
+	BenchmarkRate parallelTrial([&](int repeats, Timer &timer) {
+		runWrite(0, repeats, timer, parallel);
+	});
+	double serialRate = serialTrial.run(), parallelRate = parallelTrial.run();
+	test.log("serial:\t", 1e3/serialRate, " ms/write");
+	test.log("parallel (", std::thread::hardware_concurrency(), " threads):\t", 1e3/parallelRate, " ms/write");
+	test.log("speed-up:\t", parallelRate/serialRate);
+
+	TEST_ASSERT(serial == expected);
+	TEST_ASSERT(parallel == expected);
+}
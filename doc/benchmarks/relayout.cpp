@@ -0,0 +1,129 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <cmath>
+
+TEST("Re-writing a Figure: incremental layout", relayout) {
+	using signalsmith::plot::Figure;
+	using signalsmith::plot::Plot2D;
+	const int columns = 10, rows = 10, pointCount = 100;
+
+	std::vector<Plot2D *> plots;
+	auto build = [&](Figure &figure, const std::string &firstTitle) {
+		plots.clear();
+		for (int c = 0; c < columns; ++c) {
+			for (int r = 0; r < rows; ++r) {
+				auto &plot = figure(c, r).plot(120, 80);
+				plot.title(c + r ? "plot " + std::to_string(c) + "/" + std::to_string(r) : firstTitle);
+				plot.x.major(0).minor(50, "50").minor(100).label("time");
+				plot.y.major(0).minors(-1, 1).label("value");
+				auto &line = plot.line();
+				for (int i = 0; i < pointCount; ++i) line.add(i, std::sin(i*0.1 + c + r));
+				plot.legend(0, 1).line(line, "signal");
+				plots.push_back(&plot);
+			}
+		}
+	};
+	auto writeString = [&](Figure &figure) {
+		std::ostringstream stream;
+		figure.write(stream);
+		return stream.str();
+	};
+
+	// Re-writing without changes gives the same output as a fresh figure
+	{
+		Figure figure, fresh;
+		build(figure, "first");
+		std::string first = writeString(figure);
+		TEST_ASSERT(writeString(figure) == first);
+		build(fresh, "first");
+		TEST_ASSERT(writeString(fresh) == first);
+	}
+	// Changing one title only re-lays-out that plot (and the grid positions), but the result matches a fresh layout
+	{
+		Figure figure, fresh;
+		build(figure, "first");
+		writeString(figure);
+		plots[0]->title("a different title");
+		plots[5]->y.flip();
+		std::string changed = writeString(figure);
+		build(fresh, "a different title");
+		plots[5]->y.flip();
+		TEST_ASSERT(writeString(fresh) == changed);
+	}
+	// Changes which don't go through the plot's own axis setters still match a fresh layout
+	{
+		using signalsmith::plot::Line2D;
+		struct Parts {
+			Plot2D *a, *b;
+			Line2D *shared, *own;
+		};
+		auto buildShared = [&](Figure &figure) {
+			Parts parts;
+			parts.a = &figure(0, 0).plot(120, 80);
+			parts.b = &figure(1, 0).plot(120, 80);
+			// Explicit ranges, so a fresh layout doesn't depend on which plot is auto-scaled first
+			parts.b->x.linear(0, 10).major(0).major(10);
+			parts.b->y.linear(0, 1).major(0).major(1).label("shared");
+			parts.a->x.linear(0, 10).major(0).major(10, "ten").label("own");
+			parts.a->y.linear(0, 1).major(0).major(1);
+			// A labelled line on the other plot's axes
+			parts.shared = &parts.a->line(parts.b->x, parts.b->y);
+			parts.shared->add(0, 0).add(10, 1).label(5, 0.5, "on b", 45, 10);
+			parts.own = &parts.a->line();
+			parts.own->add(0, 0).add(10, 1).label("own");
+			return parts;
+		};
+		std::vector<std::function<void(Parts &)>> changes = {
+			[](Parts &p) {
+				p.b->y.linear(0, 2);
+			},
+			[](Parts &p) {
+				p.a->x.styleIndex = 2;
+			},
+			[](Parts &p) {
+				p.a->x.tickList[1].name = "TEN";
+			},
+			[](Parts &p) {
+				p.shared->styleIndex = 3;
+			}
+		};
+		for (auto &change : changes) {
+			Figure figure, fresh;
+			Parts parts = buildShared(figure);
+			std::string first = writeString(figure);
+			change(parts);
+			std::string changed = writeString(figure);
+			TEST_ASSERT(changed != first);
+			Parts freshParts = buildShared(fresh);
+			change(freshParts);
+			TEST_ASSERT(writeString(fresh) == changed);
+		}
+	}
+
+	Figure figure;
+	build(figure, "first");
+	writeString(figure);
+	double fullLayout = 0, incrementalLayout = 0;
+	BenchmarkRate freshTrial([&](int repeats, Timer &timer) {
+		for (int r = 0; r < repeats; ++r) {
+			Figure fresh;
+			build(fresh, "first");
+			timer.start();
+			writeString(fresh);
+			timer.stop();
+			fullLayout = fresh.lastWrite.layoutSeconds;
+		}
+	});
+	BenchmarkRate rewriteTrial([&](int repeats, Timer &timer) {
+		for (int r = 0; r < repeats; ++r) {
+			timer.start();
+			writeString(figure);
+			timer.stop();
+			incrementalLayout = figure.lastWrite.layoutSeconds;
+		}
+	});
+	double freshRate = freshTrial.run(), rewriteRate = rewriteTrial.run();
+	test.log("layout:\tfull ", fullLayout*1e3, " ms\tunchanged ", incrementalLayout*1e3, " ms");
+	test.log("write:\t", 1e3/rewriteRate, " ms (of which layout ", incrementalLayout*rewriteRate*100, "%, vs ", fullLayout*freshRate*100, "% when new)");
+}
@@ -0,0 +1,103 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <random>
+#include <algorithm>
+
+TEST("Line2D::rolling() - live window vs rebuilding the plot", rolling_line) {
+	const size_t capacity = 10000, updates = 50, perUpdate = 1000;
+	std::mt19937 randomEngine(12345);
+	std::normal_distribution<double> step(0, 1);
+	std::vector<double> values(capacity + updates*perUpdate);
+	double walk = 0;
+	for (auto &v : values) v = (walk += step(randomEngine));
+
+	// The window's range should be tracked exactly as old values drop out
+	{
+		signalsmith::plot::Plot2D plot(500, 200);
+		auto &line = plot.line().rolling(capacity);
+		for (size_t u = 0; u < 20; ++u) {
+			size_t end = capacity + u*perUpdate;
+			for (size_t i = end - perUpdate; i < end; ++i) line.add(i, values[i]);
+			plot.x.autoRescale();
+			plot.y.autoRescale();
+			std::ostringstream stream;
+			plot.write(stream);
+
+			size_t start = std::max(capacity - perUpdate, end - capacity);
+			auto minmax = std::minmax_element(values.begin() + start, values.begin() + end);
+			TEST_ASSERT(std::abs(plot.y.map(*minmax.first) - plot.y.drawLow) < 1e-6);
+			TEST_ASSERT(std::abs(plot.y.map(*minmax.second) - plot.y.drawHigh) < 1e-6);
+			TEST_ASSERT(std::abs(plot.x.map(double(start)) - plot.x.drawLow) < 1e-6);
+		}
+	}
+
+	// Each update: build a new plot from the latest values
+	BenchmarkRate rebuildTrial([&](int repeats, Timer &timer) {
+		timer.start();
+		for (int r = 0; r < repeats; ++r) {
+			for (size_t u = 0; u < updates; ++u) {
+				size_t end = capacity + u*perUpdate;
+				signalsmith::plot::Plot2D plot(500, 200);
+				auto &line = plot.line();
+				for (size_t i = end - capacity; i < end; ++i) line.add(i, values[i]);
+				std::ostringstream stream;
+				plot.write(stream);
+			}
+		}
+		timer.stop();
+	});
+	// Each update: push the new values into one rolling line, and re-write
+	BenchmarkRate rollingTrial([&](int repeats, Timer &timer) {
+		timer.start();
+		for (int r = 0; r < repeats; ++r) {
+			signalsmith::plot::Plot2D plot(500, 200);
+			auto &line = plot.line().rolling(capacity);
+			for (size_t i = 0; i < capacity; ++i) line.add(i, values[i]);
+			for (size_t u = 0; u < updates; ++u) {
+				size_t end = capacity + u*perUpdate;
+				for (size_t i = end - perUpdate; i < end; ++i) line.add(i, values[i]);
+				plot.x.autoRescale();
+				plot.y.autoRescale();
+				std::ostringstream stream;
+				plot.write(stream);
+			}
+		}
+		timer.stop();
+	});
+	// Just the pushes, including the min/max tracking
+	BenchmarkRate pushTrial([&](int repeats, Timer &timer) {
+		signalsmith::plot::Plot2D plot(500, 200);
+		auto &line = plot.line().rolling(capacity);
+		timer.start();
+		for (int r = 0; r < repeats; ++r) {
+			for (size_t i = 0; i < values.size(); ++i) line.add(i, values[i]);
+		}
+		timer.stop();
+	});
+	double rebuildRate = rebuildTrial.run(), rollingRate = rollingTrial.run(), pushRate = pushTrial.run();
+	test.log("update:\trebuild ", 1e3/rebuildRate/updates, " ms\trolling ", 1e3/rollingRate/updates, " ms\tspeed-up ", rollingRate/rebuildRate);
+	test.log("push:\t", 1e9/pushRate/values.size(), " ns/point");
+}
+
+TEST("Line2D::rolling() - auto-scale across animation frames", rolling_line_frames) {
+	// Frame 0 is around 100, frame 1 is around 0: both frames should count towards the auto-scale, the same as a normal line
+	auto build = [](signalsmith::plot::Plot2D &plot, bool rolling) {
+		auto &line = plot.line();
+		if (rolling) line.rolling(10);
+		for (int i = 0; i < 10; ++i) line.add(i, 100 + i%2);
+		plot.toFrame(0);
+		for (int i = 0; i < 10; ++i) line.add(i, i%2);
+		plot.toFrame(1);
+		std::ostringstream stream;
+		plot.write(stream);
+	};
+	signalsmith::plot::Plot2D rollingPlot(500, 200), normalPlot(500, 200);
+	build(rollingPlot, true);
+	build(normalPlot, false);
+	for (double y : {0.0, 1.0, 50.0, 100.0, 101.0}) {
+		TEST_ASSERT(std::abs(rollingPlot.y.map(y) - normalPlot.y.map(y)) < 1e-6);
+	}
+	TEST_ASSERT(rollingPlot.y.map(0) >= rollingPlot.y.drawLow - 1e-6);
+	TEST_ASSERT(rollingPlot.y.map(101) <= rollingPlot.y.drawHigh + 1e-6);
+}
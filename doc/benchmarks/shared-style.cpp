@@ -0,0 +1,75 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <cstdio>
+#include <fstream>
+
+TEST("Shared external CSS/defs for batches of SVGs", shared_style) {
+	using signalsmith::plot::Figure;
+	using SharedStyle = signalsmith::plot::SvgFileDrawable::SharedStyle;
+	const int plotCount = 200;
+
+	auto build = [&](Figure &figure, int index) {
+		auto &plot = figure(0, 0).plot(80, 50);
+		plot.x.major(0).minor(10);
+		plot.y.major(0);
+		auto &line = plot.line(index);
+		for (int i = 0; i <= 10; ++i) line.add(i, ((i*7 + index)%5)*0.2);
+		plot.line(index + 1).fillToY(0).add(0, 0.2).add(10, 0.4);
+		plot.line(index + 2).marker(5, 0.5);
+	};
+
+	std::string cssFile = "shared-style-test.css", defsFile = "shared-style-test-defs.svg";
+	size_t inlineBytes = 0, sharedBytes = 0;
+	{
+		SharedStyle shared(cssFile, defsFile);
+		for (int i = 0; i < plotCount; ++i) {
+			Figure figure;
+			build(figure, i);
+			std::ostringstream inlineStream, sharedStream;
+			figure.write(inlineStream);
+			figure.write(sharedStream, shared);
+			std::string inlineSvg = inlineStream.str(), sharedSvg = sharedStream.str();
+			inlineBytes += inlineSvg.size();
+			sharedBytes += sharedSvg.size();
+			if (i == 0) {
+				TEST_ASSERT(inlineSvg.find("<style>") != std::string::npos);
+				TEST_ASSERT(inlineSvg.find("<?xml-stylesheet") == std::string::npos);
+				TEST_ASSERT(sharedSvg.find("<style>") == std::string::npos);
+				TEST_ASSERT(sharedSvg.find("<defs>") == std::string::npos);
+				TEST_ASSERT(sharedSvg.find("<?xml-stylesheet type=\"text/css\" href=\"shared-style-test.css\"?>") != std::string::npos);
+				TEST_ASSERT(sharedSvg.find("href=\"shared-style-test-defs.svg#svg-plot-marker") != std::string::npos);
+			}
+		}
+		std::ostringstream cssStream, defsStream;
+		shared.writeCss(cssStream);
+		shared.writeDefs(defsStream);
+		std::string css = cssStream.str(), defs = defsStream.str();
+		TEST_ASSERT(css.find("url(shared-style-test-defs.svg#svg-plot-hatch1)") != std::string::npos);
+		TEST_ASSERT(defs.find("id=\"svg-plot-hatch1\"") != std::string::npos);
+		TEST_ASSERT(defs.find("id=\"svg-plot-marker0\"") != std::string::npos);
+		sharedBytes += css.size() + defs.size();
+
+		TEST_ASSERT(shared.writeFiles());
+		std::ifstream cssIn(cssFile), defsIn(defsFile);
+		std::stringstream cssRead, defsRead;
+		cssRead << cssIn.rdbuf();
+		defsRead << defsIn.rdbuf();
+		TEST_ASSERT(cssRead.str() == css);
+		TEST_ASSERT(defsRead.str() == defs);
+	}
+	std::remove(cssFile.c_str());
+	std::remove(defsFile.c_str());
+	{
+		// Errors are reported by `.writeFiles()`, but ignored (without throwing) when destroyed
+		SharedStyle shared("missing-directory/style.css", "missing-directory/defs.svg");
+		Figure figure;
+		build(figure, 0);
+		std::ostringstream sharedStream;
+		figure.write(sharedStream, shared);
+		TEST_ASSERT(!shared.writeFiles());
+	}
+
+	test.log(plotCount, " small plots:\tinline ", inlineBytes/1024.0, " KB\tshared ", sharedBytes/1024.0, " KB (", 100.0*sharedBytes/inlineBytes, "%)");
+	TEST_ASSERT(sharedBytes*2 <= inlineBytes);
+}
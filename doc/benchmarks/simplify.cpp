@@ -0,0 +1,102 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <random>
+
+using signalsmith::plot::Point2D;
+
+// Reads the vertices from the `d` attribute of the first line path
+static std::vector<Point2D> lineVertices(const std::string &svg) {
+	size_t start = svg.find("d=\"", svg.find("svg-plot-line")) + 4; // skip the initial "M"
+	size_t end = svg.find('"', start);
+	std::istringstream stream(svg.substr(start, end - start));
+	std::vector<Point2D> result;
+	double x, y;
+	while (stream >> x >> y) result.push_back({x, y});
+	return result;
+}
+
+static double segmentDistance(Point2D p, Point2D a, Point2D b) {
+	double dx = b.x - a.x, dy = b.y - a.y, length2 = dx*dx + dy*dy;
+	double t = length2 ? ((p.x - a.x)*dx + (p.y - a.y)*dy)/length2 : 0;
+	t = std::max(0.0, std::min(1.0, t));
+	return std::hypot(p.x - a.x - t*dx, p.y - a.y - t*dy);
+}
+
+TEST("Path simplification: accumulated vs maxError", simplify_vertices) {
+	using Simplify = signalsmith::plot::PlotStyle::Simplify;
+	const int pointCount = 1000000;
+	std::mt19937 randomEngine(12345);
+	std::normal_distribution<double> noise;
+
+	struct Signal {
+		std::string name;
+		std::function<double(int)> fn;
+	};
+	double walk = 0;
+	std::vector<Signal> signals = {
+		{"smooth", [&](int i) {
+			return std::sin(i*2e-5);
+		}},
+		{"noisy", [&](int i) {
+			return std::sin(i*2e-5) + 0.02*noise(randomEngine);
+		}},
+		{"random walk", [&](int) {
+			return walk += noise(randomEngine);
+		}}
+	};
+
+	for (auto &signal : signals) {
+		signalsmith::plot::Plot2D plot(2400, 1000);
+		auto &line = plot.line();
+		std::vector<double> values(pointCount);
+		for (int i = 0; i < pointCount; ++i) {
+			values[i] = signal.fn(i);
+			line.add(i, values[i]);
+		}
+
+		auto run = [&](Simplify simplify, double simplifyError, const char *name) {
+			auto style = signalsmith::plot::PlotStyle::defaultStyle().copy();
+			style.simplify = simplify;
+			style.simplifyError = simplifyError;
+
+			BenchmarkRate trial([&](int repeats, Timer &timer) {
+				timer.start();
+				for (int r = 0; r < repeats; ++r) {
+					std::ostringstream output;
+					plot.write(output, style);
+				}
+				timer.stop();
+			});
+			double rate = trial.run();
+			std::ostringstream output;
+			plot.write(output, style);
+			auto vertices = lineVertices(output.str());
+
+			// Largest distance from an input point to the drawn path (both sorted by x)
+			double maxDeviation = 0;
+			size_t segment = 0;
+			for (int i = 0; i < pointCount; ++i) {
+				Point2D p{plot.x.map(i), plot.y.map(values[i])};
+				while (segment + 1 < vertices.size() && std::max(vertices[segment].x, vertices[segment + 1].x) < p.x - 0.1) ++segment;
+				double distance = 1e10;
+				for (size_t s = segment; s + 1 < vertices.size() && std::min(vertices[s].x, vertices[s + 1].x) <= p.x + 0.1; ++s) {
+					distance = std::min(distance, segmentDistance(p, vertices[s], vertices[s + 1]));
+				}
+				maxDeviation = std::max(maxDeviation, distance);
+			}
+
+			test.log(signal.name, "\t", name, ":\t", vertices.size(), " vertices\t", 1e3/rate*1e6/pointCount, " ms per million points\tmax deviation ", maxDeviation);
+			return std::make_pair(vertices.size(), maxDeviation);
+		};
+		double rounding = 0.5*std::sqrt(2.0)/100; // vertices are rounded to the default precision
+		auto accumulated = run(Simplify::accumulated, 0, "accumulated");
+		auto maxError = run(Simplify::maxError, 0, "maxError");
+		TEST_ASSERT(maxError.second <= 0.01 + rounding);
+		// `accumulated` doesn't bound the actual deviation, so compare at the error it actually produced
+		double tolerance = accumulated.second;
+		auto sameError = run(Simplify::maxError, tolerance, "maxError (same deviation)");
+		TEST_ASSERT(sameError.second <= tolerance + rounding);
+		TEST_ASSERT(sameError.first <= accumulated.first);
+	}
+}
@@ -0,0 +1,77 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+TEST("Cached CSS/defs for a shared PlotStyle", style_cache) {
+	using signalsmith::plot::PlotStyle;
+	using signalsmith::plot::Figure;
+
+	auto build = [&](Figure &figure) {
+		auto &plot = figure(0, 0).plot(80, 50);
+		plot.x.major(0).minor(10);
+		plot.y.major(0);
+		plot.line().add(0, 0).add(5, 1).add(10, 0.5);
+		plot.line().marker(5, 0.5).fillToY(0).add(0, 0.2).add(10, 0.2);
+	};
+	auto writeString = [&](Figure &figure, bool streamNumbers) {
+		std::ostringstream stream;
+		signalsmith::plot::SvgOutput output(stream);
+		output.streamNumbers = streamNumbers; // this doesn't use the cache
+		figure.write(output);
+		output.flush();
+		return stream.str();
+	};
+
+	{
+		PlotStyle style;
+		size_t version = style.version();
+		TEST_ASSERT(style.version() == version);
+		style.lineWidth = 2;
+		TEST_ASSERT(style.version() > version);
+		version = style.version();
+		style.hatches[1].angles[0] = 45;
+		TEST_ASSERT(style.version() > version);
+		version = style.version();
+		style.cssSuffix = ".svg-plot-s0{stroke:#000}";
+		TEST_ASSERT(style.version() > version);
+	}
+	{
+		Figure figure, fresh;
+		build(figure);
+		build(fresh);
+		std::string first = writeString(figure, false);
+		TEST_ASSERT(writeString(figure, false) == first); // from the cache
+		TEST_ASSERT(writeString(figure, true) == first); // without the cache
+		TEST_ASSERT(writeString(fresh, false) == first); // copies of the same style share the cache
+
+		// Changes to the style are picked up
+		figure.style.colours[0] = "#123456";
+		figure.style.markers[0] = "<rect x=\"-1\" y=\"-1\" width=\"2\" height=\"2\"/>";
+		std::string changed = writeString(figure, false);
+		TEST_ASSERT(changed != first);
+		TEST_ASSERT(changed.find("#123456") != std::string::npos);
+		TEST_ASSERT(writeString(figure, true) == changed);
+		TEST_ASSERT(writeString(fresh, false) == first);
+	}
+
+	const int plotCount = 100;
+	auto runBatch = [&](bool sharedStyle, int repeats, Timer &timer) {
+		for (int r = 0; r < repeats; ++r) {
+			for (int p = 0; p < plotCount; ++p) {
+				Figure figure;
+				if (!sharedStyle) figure.style = PlotStyle(); // separate cache, so it's generated every time
+				build(figure);
+				timer.start();
+				writeString(figure, false);
+				timer.stop();
+			}
+		}
+	};
+	BenchmarkRate uncachedTrial([&](int repeats, Timer &timer) {
+		runBatch(false, repeats, timer);
+	});
+	BenchmarkRate cachedTrial([&](int repeats, Timer &timer) {
+		runBatch(true, repeats, timer);
+	});
+	double uncachedRate = uncachedTrial.run(), cachedRate = cachedTrial.run();
+	test.log("write small plot:\tuncached ", 1e6/uncachedRate/plotCount, " us\tcached ", 1e6/cachedRate/plotCount, " us");
+}
@@ -0,0 +1,141 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <random>
+
+// Counts the bytes, without storing them anywhere
+struct NullBuffer : public std::streambuf {
+	size_t bytes = 0;
+	std::streamsize xsputn(const char *, std::streamsize count) override {
+		bytes += count;
+		return count;
+	}
+	int overflow(int c) override {
+		++bytes;
+		return c;
+	}
+};
+
+TEST("SvgOutput vs std::ostream formatting (Line2D)", svg_output_line2d) {
+	signalsmith::plot::Plot2D plot(5000, 1000); // large enough that most points are kept
+	auto &line = plot.line();
+	std::mt19937 randomEngine(12345);
+	std::uniform_real_distribution<double> noise(-1, 1);
+	const int pointCount = 1000000;
+	for (int i = 0; i < pointCount; ++i) {
+		line.add(i, noise(randomEngine));
+	}
+
+	auto runWrite = [&](bool buffered, int repeats, Timer &timer) {
+		NullBuffer nullBuffer;
+		std::ostream stream(&nullBuffer);
+		timer.start();
+		for (int r = 0; r < repeats; ++r) {
+			// Unbuffered with `std::ostream` numbers is equivalent to writing straight to the stream
+			signalsmith::plot::SvgOutput output(stream, buffered ? 65536 : 0);
+			output.streamNumbers = !buffered;
+			plot.write(output);
+			output.flush();
+		}
+		timer.stop();
+		return nullBuffer.bytes/repeats;
+	};
+
+	size_t streamBytes = 0, bufferedBytes = 0;
+	BenchmarkRate streamTrial([&](int repeats, Timer &timer) {
+		streamBytes = runWrite(false, repeats, timer);
+	});
+	BenchmarkRate bufferedTrial([&](int repeats, Timer &timer) {
+		bufferedBytes = runWrite(true, repeats, timer);
+	});
+	double streamRate = streamTrial.run(), bufferedRate = bufferedTrial.run();
+
+	test.log("std::ostream:\t", streamBytes, " bytes\t", 1e3/streamRate, " ms/write\t", 1e9/streamRate/pointCount, " ns/point");
+	test.log("SvgOutput:\t", bufferedBytes, " bytes\t", 1e3/bufferedRate, " ms/write\t", 1e9/bufferedRate/pointCount, " ns/point");
+	test.log("speed-up:\t", bufferedRate/streamRate);
+	
+	// Check the output actually matches
+	std::ostringstream streamOutput, bufferedOutput;
+	{
+		signalsmith::plot::SvgOutput output(streamOutput, 0);
+		output.streamNumbers = true;
+		plot.write(output);
+	}
+	plot.write(bufferedOutput);
+	TEST_ASSERT(streamOutput.str() == bufferedOutput.str());
+}
+
+TEST("Path encodings (smooth Line2D)", svg_path_encoding) {
+	using signalsmith::plot::PlotStyle;
+	const int pointCount = 100000;
+	const char *names[] = {"absolute", "relative", "scaledInteger"};
+	for (int e = 0; e < 3; ++e) {
+		signalsmith::plot::Figure figure;
+		figure.style.pathEncoding = PlotStyle::PathEncoding(e);
+		auto &plot = figure(0, 0).plot(2400, 1000);
+		auto &line = plot.line();
+		for (int i = 0; i < pointCount; ++i) {
+			line.add(i, std::sin(i*0.0003) + 0.1*std::sin(i*0.0071));
+		}
+
+		NullBuffer nullBuffer;
+		std::ostream stream(&nullBuffer);
+		size_t bytes = 0;
+		BenchmarkRate trial([&](int repeats, Timer &timer) {
+			nullBuffer.bytes = 0;
+			timer.start();
+			for (int r = 0; r < repeats; ++r) figure.write(stream);
+			timer.stop();
+			bytes = nullBuffer.bytes/repeats;
+		});
+		double rate = trial.run();
+		test.log(names[e], ":\t", bytes, " bytes\t", 1e3/rate, " ms/write");
+	}
+}
+
+TEST("SvgOutput numbers don't depend on the locale", svg_output_locale) {
+	auto writeNumbers = [](bool streamNumbers) {
+		std::ostringstream stream;
+		stream.imbue(std::locale::classic());
+		{
+			signalsmith::plot::SvgOutput output(stream);
+			output.streamNumbers = streamNumbers;
+			output.hold(); // so `streamNumbers` goes through the internal stream as well
+			for (double v : {1.5, -0.25, 1234567.0, 0.0000123, 2.5e10, 0.1234565 /* near a rounding tie */}) output << v << ' ';
+			output << 3.75f << ' ' << 1.5L;
+			output.release();
+			output.flush();
+		}
+		return stream.str();
+	};
+	std::string expected = writeNumbers(false);
+	TEST_ASSERT(expected == "1.5 -0.25 1.23457e+06 1.23e-05 2.5e+10 0.123456 3.75 1.5");
+
+	// Comma decimal separator for C++ streams
+	struct CommaDecimal : public std::numpunct<char> {
+		char do_decimal_point() const override {
+			return ',';
+		}
+	};
+	std::locale previous = std::locale::global(std::locale(std::locale::classic(), new CommaDecimal));
+	std::string commaCpp = writeNumbers(false), commaCppStreamed = writeNumbers(true);
+	std::locale::global(previous);
+	TEST_ASSERT(commaCpp == expected);
+	TEST_ASSERT(commaCppStreamed == expected);
+
+	// Comma decimal separator for C functions (`LC_NUMERIC`), if one is installed
+	for (const char *name : {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR"}) {
+		std::locale named;
+		try {
+			named = std::locale(name);
+		} catch (const std::runtime_error &) {
+			continue;
+		}
+		previous = std::locale::global(named);
+		std::string commaC = writeNumbers(false);
+		std::locale::global(previous);
+		TEST_ASSERT(commaC == expected);
+		test.log("checked with locale:\t", name);
+		break;
+	}
+}
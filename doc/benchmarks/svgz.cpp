@@ -0,0 +1,32 @@
+#include "../util/test/tests.h"
+#include "../../plot.h"
+
+#include <random>
+
+TEST("GzipOutput compression levels (.svgz)", svgz_levels) {
+	signalsmith::plot::Figure figure;
+	auto &plot = figure(0, 0).plot(2400, 1000);
+	std::mt19937 randomEngine(12345);
+	std::uniform_real_distribution<double> noise(-1, 1);
+	for (int l = 0; l < 4; ++l) {
+		auto &line = plot.line();
+		for (int i = 0; i < 100000; ++i) {
+			line.add(i, l + std::sin(i*0.0003) + 0.05*noise(randomEngine));
+		}
+	}
+
+	std::string svg;
+	{
+		std::ostringstream stream;
+		figure.write(stream);
+		svg = stream.str();
+	}
+	for (int level = 0; level <= 9; level += 3) {
+		std::ostringstream compressed;
+		signalsmith::plot::GzipOutput output(compressed, level);
+		output.append(svg);
+		output.finish();
+		TEST_ASSERT(output.outputBytes() == compressed.str().size());
+		test.log("level ", level, ":\t", output.inputBytes(), " -> ", output.outputBytes(), " bytes\tratio ", double(output.inputBytes())/output.outputBytes(), "\t", output.compressSeconds()*1e3, " ms");
+	}
+}
@@ -8,6 +8,7 @@
 #include <string>
 #include <fstream>
 #include <cstdint>
+#include <cstring>
 #include <cmath>
 #include <sstream>
 
@@ -61,13 +62,14 @@ namespace signalsmith { namespace plot {
 	@file
 **/
 
-/** Pixel-based heat-map
+/** Pixel-based heat-map, storing values as `Value` (usually used as `HeatMap` or `HeatMap32`)
  
 	You create this separately, and then attach to a `Figure` or `Plot` later, or save directly to PNG.
  */
-struct HeatMap {
-	HeatMap(int width, int height) : HeatMap(width, height, width, height) {}
-	HeatMap(int width, int height, int outputWidth, int outputHeight) : scale(0, 1), width(width), height(height), outputWidth(outputWidth), outputHeight(outputHeight) {
+template<class Value=double>
+struct HeatMapT {
+	HeatMapT(int width, int height) : HeatMapT(width, height, width, height) {}
+	HeatMapT(int width, int height, int outputWidth, int outputHeight) : scale(0, 1), width(width), height(height), outputWidth(outputWidth), outputHeight(outputHeight) {
 		unitValues.assign(width*height, 0);
 	}
 	
@@ -111,15 +113,33 @@ struct HeatMap {
 		return dataUrl(PlotStyle::defaultStyle(), flippedY);
 	}
 
-	double & operator()(int x, int y) {
+	Value & operator()(int x, int y) {
 		if (x < 0 || x >= width || y < 0 || y >= height) return dummyValue;
 		return unitValues[x + y*width];
 	}
-	const double & operator()(int x, int y) const {
+	const Value & operator()(int x, int y) const {
 		if (x < 0 || x >= width || y < 0 || y >= height) return dummyValue;
 		return unitValues[x + y*width];
 	}
 	
+	/// Copies `count` values (row by row) from an array/pointer/container of any numeric type.  Anything beyond the map's size is ignored, and any remaining pixels are unchanged.
+	template<class Array>
+	HeatMapT & assign(Array &&values, size_t count) {
+		Value *data = unitValues.data();
+		count = std::min(count, unitValues.size());
+		for (size_t i = 0; i < count; ++i) data[i] = Value(values[i]);
+		return *this;
+	}
+	/// Copies the values from a container with `.size()`
+	template<class Container>
+	auto assign(Container &&values) -> decltype(values.size(), *this) {
+		return assign(values, values.size());
+	}
+	template<class V, size_t N>
+	HeatMapT & assign(const V (&values)[N]) {
+		return assign(values, N);
+	}
+
 	void flipY() {
 		for (int y = 0; y < height/2; ++y) {
 			int i1 = y*width, i2 = (height - 1 - y)*width;
@@ -130,8 +150,8 @@ struct HeatMap {
 	}
 
 	struct EmbeddedHeatMap : public SvgDrawable {
-		EmbeddedHeatMap(HeatMap &heatMap, Axis &x, Axis &y, bool flippedY=true) : heatMap(heatMap), x(x), y(y), flippedY(flippedY), fullBounds(true) {}
-		EmbeddedHeatMap(HeatMap &heatMap, Axis &x, Axis &y, Bounds dataBounds) : heatMap(heatMap), x(x), y(y), dataBounds(dataBounds) {
+		EmbeddedHeatMap(HeatMapT &heatMap, Axis &x, Axis &y, bool flippedY=true) : heatMap(heatMap), x(x), y(y), flippedY(flippedY), fullBounds(true) {}
+		EmbeddedHeatMap(HeatMapT &heatMap, Axis &x, Axis &y, Bounds dataBounds) : heatMap(heatMap), x(x), y(y), dataBounds(dataBounds) {
 			x.autoValue(dataBounds.left);
 			x.autoValue(dataBounds.right);
 			y.autoValue(dataBounds.top);
@@ -151,34 +171,34 @@ struct HeatMap {
 				.attr("preserveAspectRatio", "none").attr("href", heatMap.dataUrl(style, flippedY));
 		}
 	private:
-		HeatMap &heatMap;
+		HeatMapT &heatMap;
 		Axis &x, &y;
 		bool flippedY = true, fullBounds = false;
 		Bounds dataBounds;
 	};
 	struct RetainedMap : public SvgDrawable {
-		RetainedMap(HeatMap *map) : map(map) {}
-		std::unique_ptr<HeatMap> map;
+		RetainedMap(HeatMapT *map) : map(map) {}
+		std::unique_ptr<HeatMapT> map;
 	};
 
 	Plot2D & addTo(Plot2D &plot, Bounds dataBounds) {
-		auto *embedded = new EmbeddedHeatMap(*this, plot.x, plot.y, dataBounds);
+		auto *embedded = plot.create<EmbeddedHeatMap>(*this, plot.x, plot.y, dataBounds);
 		plot.addChild(embedded);
 		return plot;
 	}
 	Plot2D & addTo(Plot2D &plot, Bounds dataBounds, Plot2D &scalePlot) {
-		auto *embedded = new EmbeddedHeatMap(*this, plot.x, plot.y, dataBounds);
+		auto *embedded = plot.create<EmbeddedHeatMap>(*this, plot.x, plot.y, dataBounds);
 		plot.addChild(embedded);
 		addScaleTo(scalePlot);
 		return plot;
 	}
 	Plot2D & addTo(Plot2D &plot, bool flippedY=true) {
-		auto *embedded = new EmbeddedHeatMap(*this, plot.x, plot.y, flippedY);
+		auto *embedded = plot.create<EmbeddedHeatMap>(*this, plot.x, plot.y, flippedY);
 		plot.addChild(embedded);
 		return plot;
 	}
 	Plot2D & addTo(Plot2D &plot, Plot2D &scalePlot, bool flippedY=true) {
-		auto *embedded = new EmbeddedHeatMap(*this, plot.x, plot.y, flippedY);
+		auto *embedded = plot.create<EmbeddedHeatMap>(*this, plot.x, plot.y, flippedY);
 		plot.addChild(embedded);
 		addScaleTo(scalePlot);
 		return plot;
@@ -188,11 +208,11 @@ struct HeatMap {
 		bool vertical = std::abs(scalePlot.x.drawHigh - scalePlot.x.drawLow) <= std::abs(scalePlot.y.drawHigh - scalePlot.y.drawLow);
 
 		// Create and retain a colour map image
-		auto *scaleMap = new HeatMap(vertical ? 1 : 256, vertical ? 256 : 1);
+		auto *scaleMap = new HeatMapT(vertical ? 1 : 256, vertical ? 256 : 1);
 		scaleMap->light = light;
-		scalePlot.addChild(new RetainedMap(scaleMap));
+		scalePlot.addChild(scalePlot.create<RetainedMap>(scaleMap));
 
-		auto *embeddedScale = new EmbeddedHeatMap(*scaleMap, scalePlot.x, scalePlot.y);
+		auto *embeddedScale = scalePlot.create<EmbeddedHeatMap>(*scaleMap, scalePlot.x, scalePlot.y);
 		scalePlot.addChild(embeddedScale);
 		if (vertical) {
 			for (int y = 0; y < 256; ++y) (*scaleMap)(0, y) = y/255.0;
@@ -212,35 +232,31 @@ struct HeatMap {
 	/// Makes a retained copy of the map, then calls `.addTo(...)`
 	template<class Drawable, class... Args>
 	auto copyTo(Drawable &drawable, Args &&...args) -> decltype(this->addTo(drawable, std::forward<Args>(args)...)) {
-		HeatMap *copy = new HeatMap(*this);
-		drawable.addChild(new RetainedMap(copy));
+		HeatMapT *copy = new HeatMapT(*this);
+		drawable.addChild(drawable.template create<RetainedMap>(copy));
 		return copy->addTo(drawable, std::forward<Args>(args)...);
 	}
 
-	typename std::vector<double>::iterator begin() {
+	typename std::vector<Value>::iterator begin() {
 		return unitValues.begin();
 	}
-	typename std::vector<double>::iterator end() {
+	typename std::vector<Value>::iterator end() {
 		return unitValues.end();
 	}
-	typename std::vector<double>::const_iterator begin() const {
+	typename std::vector<Value>::const_iterator begin() const {
 		return unitValues.begin();
 	}
-	typename std::vector<double>::const_iterator end() const {
+	typename std::vector<Value>::const_iterator end() const {
 		return unitValues.end();
 	}
 private:
 
 	int width, height, outputWidth, outputHeight;
-	std::vector<double> unitValues;
-	double dummyValue;
+	std::vector<Value> unitValues;
+	Value dummyValue;
 	
 	static void colourMap(const PlotStyle &style, double v, uint8_t *rgba8) {
-		double rgba[4] = {v, v, v, 1};
-		style.cmap(v, rgba);
-		for (int c = 0; c < 4; ++c) {
-			rgba8[c] = std::round(255*std::max(0.0, std::min(1.0, rgba[c])));
-		}
+		std::memcpy(rgba8, style.cmap.rgba8(v), 4);
 	}
 
 	// PNG file contents
@@ -251,6 +267,10 @@ private:
 	
 		double scaleX = outputWidth > 1 ? (width - 1.0)/(outputWidth - 1.0) : (width - 1.0);
 		double scaleY = outputHeight > 1 ? (height - 1.0)/(outputHeight - 1.0) : (height - 1.0);
+		// Map all the values up-front, instead of for each output pixel they contribute to
+		std::vector<double> scaled(unitValues.size());
+		scale.map(unitValues.data(), scaled.data(), scaled.size());
+		for (auto &v : scaled) v = std::max(0.0, std::min(1.0, v));
 		auto getScaledPixel = [&](int outX, int outY) {
 			double scaledSum = 0, counter = 0;
 			double inX = outX*scaleX;
@@ -264,7 +284,7 @@ private:
 					double wy = 1 - std::abs(y - inY)/spanY;
 					wy *= wy*(3 - 2*wy);
 					double w = wx*wy;
-					double v = std::max(0.0, std::min(1.0, scale.map((*this)(x, y))));
+					double v = scaled[x + y*width];
 					scaledSum += v*w;
 					counter += w;
 				}
@@ -324,16 +344,16 @@ private:
 		startChunk("IEND").endChunk();
 	}
 	
-	HeatMap & addBytes(const char* cStr, int bytes) {
+	HeatMapT & addBytes(const char* cStr, int bytes) {
 		for (int i = 0; i < bytes; ++i) pngBytes.push_back(cStr[i]);
 		return *this;
 	}
-	HeatMap & addInt(uint32_t value, int bytes, bool bigEndian=true) {
+	HeatMapT & addInt(uint32_t value, int bytes, bool bigEndian=true) {
 		size_t index = pngBytes.size();
 		pngBytes.resize(index + bytes);
 		return writeInt(value, bytes, index, bigEndian);
 	}
-	HeatMap & writeInt(uint32_t value, int bytes, int startIndex, bool bigEndian=true) {
+	HeatMapT & writeInt(uint32_t value, int bytes, int startIndex, bool bigEndian=true) {
 		for (int i = 0; i < bytes; ++i) {
 			uint8_t byte = (value >> (i*8))&0xff;
 			int index = bigEndian ? (startIndex + bytes - 1 - i) : (startIndex + i);
@@ -341,11 +361,11 @@ private:
 		}
 		return *this;
 	}
-	HeatMap & addInt32(uint32_t value, bool bigEndian=true) {
+	HeatMapT & addInt32(uint32_t value, bool bigEndian=true) {
 		return addInt(value, 4, bigEndian);
 	}
 	size_t chunkStartIndex = 0;
-	HeatMap & startChunk(const char *key) {
+	HeatMapT & startChunk(const char *key) {
 		chunkStartIndex = pngBytes.size();
 		addInt32(0); // this will be replaced by the size later
 		addBytes(key, 4);
@@ -434,12 +454,21 @@ private:
 		}
 		writeCode(0, 7); // end-of-block code
 	}
-	HeatMap & endDeflate() {
+	HeatMapT & endDeflate() {
 		if (pendingBits) writeCode(0, 8 - pendingBits);
 		return addInt32(adlerA + adlerB*65536);
 	}
 };
 
+/// Heat-map storing `double`s
+struct HeatMap : public HeatMapT<double> {
+	using HeatMapT<double>::HeatMapT;
+};
+/// Heat-map storing `float`s, using half the memory
+struct HeatMap32 : public HeatMapT<float> {
+	using HeatMapT<float>::HeatMapT;
+};
+
 /// @}
 }} // namespace
 #endif // include guard
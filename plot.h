@@ -8,8 +8,21 @@
 #include <memory>
 #include <functional>
 #include <vector>
+#include <array>
 #include <cmath>
 #include <sstream>
+#include <string>
+#include <cstring>
+#include <locale>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
 
 namespace signalsmith { namespace plot {
 
@@ -46,6 +59,18 @@ public:
 	double scale = 1; ///< scales the entire plot (including adjusting the precision)
 	double padding = 10;
 	double lineWidth = 1.5, precision = 100;
+	/** How paths drop points along almost-straight lines:
+		* `accumulated`: drops points until their summed distance from the drawn line exceeds `1/precision`
+		* `maxError`: guarantees that each dropped point is within `simplifyError` of the drawn line (or `1/precision` if that is `0`).  `accumulated` can drift much further than `1/precision` from noisy data, so at the same actual deviation this keeps far fewer points. */
+	enum class Simplify {accumulated, maxError};
+	Simplify simplify = Simplify::accumulated;
+	double simplifyError = 0;
+	/** How path co-ordinates are written:
+		* `absolute`: `M x y x y ...`
+		* `relative`: first point absolute, then `l dx dy ...` deltas on the `precision` grid, which is more compact for long smooth lines
+		* `scaledInteger`: like `relative`, but with integer deltas and a `scale()` transform (using a non-scaling stroke).  Fills still use `relative`, so that hatching isn't scaled. */
+	enum class PathEncoding {absolute, relative, scaledInteger};
+	PathEncoding pathEncoding = PathEncoding::absolute;
 	double markerSize = 3.25;
 	double tickH = 4, tickV = 4;
 	// Text
@@ -56,6 +81,14 @@ public:
 	double fillOpacity = 0.28, dotOpacity = 0.5;
 	double hatchWidth = 1, hatchSpacing = 3;
 	double animation = 2; ///< Animation duration
+	int compressionLevel = 6; ///< 0-9, used when writing `.svgz` files
+	/** Animate lines using an embedded script instead of SMIL `<animate>`, which stores frames as changes relative to keyframes - much smaller when only parts of a line change.
+		The static image (e.g. if scripts are disabled) shows the final frame. */
+	bool scriptAnimation = false;
+	/** Draws (non-animated) dots which share a radius and colour as one shared `<path>` of arcs (used for both fill and border), which is much smaller and faster to render for large scatter plots.
+		Overlapping dots within a group don't stack their opacity, and groups are drawn in order of colour/radius rather than the order the dots were added. */
+	bool compactDots = false;
+	int compactDotColours = 64; ///< colour-mapped dots are quantised to this many steps, when using `compactDots`
 
 	std::string scriptHref = "", scriptSrc = "";
 	std::string cssPrefix = "", cssSuffix = "";
@@ -88,6 +121,13 @@ public:
 		Counter(int colour, int dash, int hatch, int marker) : colour(colour), dash(dash), hatch(hatch), marker(marker) {}
 		Counter(int index=0) : colour(index), dash(index), hatch(index), marker(index) {}
 
+		bool operator==(const Counter &other) const {
+			return colour == other.colour && dash == other.dash && hatch == other.hatch && marker == other.marker;
+		}
+		bool operator!=(const Counter &other) const {
+			return !(*this == other);
+		}
+
 		/// Increment the counter, and return the previous value
 		Counter bump() {
 			Counter result = *this;
@@ -110,35 +150,104 @@ public:
 			return Counter(colour, dash, hatch, index);
 		}
 	};
-	std::string strokeClass(const Counter &counter) const {
-		if (counter.colour < 0 || colours.size() == 0) return "svg-plot-s";
-		return "svg-plot-s" + std::to_string(counter.colour%(int)colours.size());
+	/// Class names (and marker IDs) for each colour/dash/hatch/marker.  Index `0` is the fallback (e.g. for negative style indices), and `N + 1` is for index `N`.
+	struct ClassNames {
+		std::vector<std::string> stroke, fill, text, dash, hatch, marker;
+
+		ClassNames(const PlotStyle &style) {
+			add(stroke, "svg-plot-s", style.colours.size());
+			add(fill, "svg-plot-f", style.colours.size());
+			add(text, "svg-plot-t", style.colours.size());
+			add(dash, "svg-plot-d", style.dashes.size());
+			add(hatch, "svg-plot-h", style.hatches.size());
+			add(marker, "svg-plot-marker", style.markers.size());
+		}
+		/// Names only depend on how many colours/dashes/hatches/markers there are
+		bool matches(const PlotStyle &style) const {
+			return stroke.size() == style.colours.size() + 1 && dash.size() == style.dashes.size() + 1 && hatch.size() == style.hatches.size() + 1 && marker.size() == style.markers.size() + 1;
+		}
+		static const std::string & get(const std::vector<std::string> &names, int index) {
+			if (index < 0 || names.size() <= 1) return names[0];
+			return names[1 + index%int(names.size() - 1)];
+		}
+	private:
+		static void add(std::vector<std::string> &names, const char *prefix, size_t count) {
+			names.emplace_back(prefix);
+			for (size_t i = 0; i < count; ++i) names.emplace_back(prefix + std::to_string(i));
+		}
+	};
+	/// Rebuilt (if needed) when `.colours`/`.dashes`/`.hatches`/`.markers` changes size
+	const ClassNames & classNames() const {
+		return classNameCache.get(*this);
 	}
-	std::string fillClass(const Counter &counter) const {
-		if (counter.colour < 0 || colours.size() == 0) return "svg-plot-f";
-		return "svg-plot-f" + std::to_string(counter.colour%(int)colours.size());
+	const std::string & strokeClass(const Counter &counter) const {
+		return ClassNames::get(classNames().stroke, counter.colour);
 	}
-	std::string textClass(const Counter &counter) const {
-		if (counter.colour < 0 || colours.size() == 0) return "svg-plot-t";
-		return "svg-plot-t" + std::to_string(counter.colour%(int)colours.size());
+	const std::string & fillClass(const Counter &counter) const {
+		return ClassNames::get(classNames().fill, counter.colour);
 	}
-	std::string dashClass(const Counter &counter) const {
-		if (counter.dash < 0 || dashes.size() == 0) return "svg-plot-d";
-		return "svg-plot-d" + std::to_string(counter.dash%(int)dashes.size());
+	const std::string & textClass(const Counter &counter) const {
+		return ClassNames::get(classNames().text, counter.colour);
 	}
-	std::string hatchClass(const Counter &counter) const {
-		if (counter.hatch < 0 || hatches.size() == 0) return "svg-plot-h";
-		return "svg-plot-h" + std::to_string(counter.hatch%(int)hatches.size());
+	const std::string & dashClass(const Counter &counter) const {
+		return ClassNames::get(classNames().dash, counter.dash);
 	}
-	std::string markerId(const Counter &counter) const {
-		return "svg-plot-marker" + std::to_string(std::abs(counter.marker)%(int)markers.size());
+	const std::string & hatchClass(const Counter &counter) const {
+		return ClassNames::get(classNames().hatch, counter.hatch);
+	}
+	const std::string & markerId(const Counter &counter) const {
+		return ClassNames::get(classNames().marker, std::abs(counter.marker));
 	}
 	const std::string & markerRaw(const Counter &counter) const {
 		int index = std::abs(counter.marker)%(int)markers.size();
 		return markers[index];
 	}
 	
-	void css(std::ostream &o) const {
+	/// Player for `scriptAnimation`, which is synced to the SMIL timeline (so other `<animate>`s stay in step)
+	static const char * scriptAnimationPlayer() {
+		// No `<` or `&`, so this is valid both in SVG files and inline SVG
+		return "(function(){"
+			"var tokenise=function(d){return d.match(/[a-df-z]|[-+]?[0-9.]+(?:e[-+]?[0-9]+)?/gi)||[];};"
+			"var run=function(){"
+			"document.querySelectorAll('[data-svg-plot-frames]').forEach(function(path){"
+				"if(path.svgPlotPlayer)return;"
+				"path.svgPlotPlayer=1;"
+				"var attr=function(n){return path.getAttribute('data-svg-plot-'+n);};"
+				"var svg=path.ownerSVGElement,base=path.getAttribute('d'),dur=parseFloat(attr('dur')),loop=attr('loop'),smooth=attr('smooth');"
+				"var times=attr('times').split(';').map(parseFloat),key=[];"
+				"var frames=attr('frames').split(';').map(function(f){"
+					"if(/^[a-z]/i.test(f))return key=tokenise(f);"
+					"var tokens=key.slice(),i=0;"
+					"f.split(',').forEach(function(group){"
+						"if(!group)return;"
+						"group=group.split(' ');"
+						"i+=parseInt(group[0]);"
+						"group.slice(1).forEach(function(v){tokens[i++]=v;});"
+					"});"
+					"return tokens;"
+				"});"
+				"var update=function(){"
+					"var t=svg.getCurrentTime()/dur,i=0;"
+					"if(loop)t-=Math.floor(t);"
+					"else if(t>=1)return path.setAttribute('d',base);"
+					"while(times.length>i+1){if(times[i+1]>t)break;++i;}"
+					"var tokens=frames[i],next=frames[i+1];"
+					"if(smooth)if(next)if(next.length==tokens.length)if(times[i+1]>times[i]){"
+						"var r=(t-times[i])/(times[i+1]-times[i]);"
+						"tokens=tokens.map(function(v,j){var a=parseFloat(v);return isNaN(a)?v:a+(parseFloat(next[j])-a)*r;});"
+					"}"
+					"path.setAttribute('d',tokens.join(' '));"
+					"requestAnimationFrame(update);"
+				"};"
+				"update();"
+			"});"
+		"};"
+		"if(document.readyState=='loading')document.addEventListener('DOMContentLoaded',run);else run();"
+		"})();";
+	}
+
+	/// Writes the CSS, where `defsHref` is the location of the `<defs>` (if they're in a separate file)
+	void css(std::ostream &o, const std::string &defsHref="") const {
 		o << R"CSS(
 			.svg-plot {
 				stroke-linecap: butt;
@@ -239,7 +348,7 @@ public:
 		for (size_t i = 0; i < hatches.size(); ++i) {
 			auto &h = hatches[i];
 			if (h.angles.size()) {
-				o << ".svg-plot-h" << i << "{mask:url(#svg-plot-hatch" << i << ")}\n";
+				o << ".svg-plot-h" << i << "{mask:url(" << defsHref << "#svg-plot-hatch" << i << ")}\n";
 			} else {
 				// Compensate for the fact that it's not hatched
 				o << ".svg-plot-h" << i << "{opacity:" << (fillOpacity*(hatchWidth/hatchSpacing*0.75 + 0.25)) << "}\n";
@@ -270,14 +379,270 @@ public:
 			rgba[c] = std::sqrt(rgbLow[c]*rgbLow[c]*rL + rgbLow[c + 3]*rgbLow[c + 3]*rH);
 		}
 	}
-	std::function<void(double,double*)> cmap = defaultCMap;
+	/** Colour-map function, which is compiled (on first use) into a lookup table with pre-formatted hex strings, so that heat-map palettes are simple lookups.
+		Table lookups (`.rgba8()`/`.hex()`) are quantised to `.steps()`, so can differ by one 8-bit step from evaluating the function.  Dots use `.exactHex()` instead.
+		The table is only rebuilt when a new function is assigned.  Copies share the same table, which is built thread-safely. */
+	class ColourMap {
+	public:
+		using Function = std::function<void(double,double*)>;
+		/// Number of steps across the 0-1 range.  This is a multiple of 255, so 8-bit palettes are exact.
+		static int steps() {
+			return 1020;
+		}
+		struct Table {
+			std::vector<uint8_t> rgba8; // 4 bytes per entry
+			std::vector<char> hex; // `#RRGGBB` or `#RRGGBBAA`, padded to 10 bytes per entry
+		};
+
+		template<class Fn, class=typename std::enable_if<!std::is_same<typename std::decay<Fn>::type, ColourMap>::value>::type>
+		ColourMap(Fn &&fn) : fn(std::forward<Fn>(fn)), compiled(std::make_shared<Compiled>()) {}
+		ColourMap(const ColourMap &other) = default;
+		ColourMap & operator=(const ColourMap &other) = default;
+		template<class Fn, class=typename std::enable_if<!std::is_same<typename std::decay<Fn>::type, ColourMap>::value>::type>
+		ColourMap & operator=(Fn &&newFn) {
+			fn = std::forward<Fn>(newFn);
+			compiled = std::make_shared<Compiled>();
+			return *this;
+		}
+
+		/// Evaluates the function directly.  `rgba` should be initialised, in case the function doesn't set all four values.
+		void operator()(double v, double *rgba) const {
+			fn(v, rgba);
+		}
+		const Function & function() const {
+			return fn;
+		}
+
+		const Table & table() const {
+			Compiled &c = *compiled;
+			std::call_once(c.once, [&]() {
+				c.table = build(fn);
+			});
+			return c.table;
+		}
+		size_t index(double v) const {
+			if (!(v > 0)) return 0; // including NaN
+			return size_t(std::min(v, 1.0)*steps() + 0.5);
+		}
+		const uint8_t * rgba8(double v) const {
+			return table().rgba8.data() + 4*index(v);
+		}
+		const char * hex(double v) const {
+			return table().hex.data() + 10*index(v);
+		}
+		/// Evaluates the function directly (without the table's quantisation) into a 10-byte `hex` buffer
+		void exactHex(double v, char *hex) const {
+			double rgba[4] = {v, v, v, 1};
+			fn(v, rgba);
+			uint8_t rgba8[4];
+			format(rgba, rgba8, hex);
+		}
+	private:
+		Function fn;
+		struct Compiled {
+			std::once_flag once;
+			Table table;
+		};
+		std::shared_ptr<Compiled> compiled;
+
+		static Table build(const Function &fn) {
+			Table table;
+			size_t size = steps() + 1;
+			table.rgba8.resize(size*4);
+			table.hex.assign(size*10, '\0');
+			for (size_t i = 0; i < size; ++i) {
+				double v = double(i)/steps();
+				double rgba[4] = {v, v, v, 1};
+				fn(v, rgba);
+				format(rgba, table.rgba8.data() + 4*i, table.hex.data() + 10*i);
+			}
+			return table;
+		}
+		/// Converts to 8-bit, and then a (null-terminated) RGB(A) hex representation
+		static void format(const double *rgba, uint8_t *rgba8, char *hex) {
+			static constexpr const char *hexChars = "0123456789ABCDEF";
+			for (size_t c = 0; c < 4; ++c) {
+				rgba8[c] = (uint8_t) std::round(255*std::max(0.0, std::min(1.0, rgba[c])));
+			}
+			size_t channels = (rgba8[3] < 255) ? 4 : 3;
+			hex[0] = '#';
+			for (size_t c = 0; c < channels; ++c) {
+				hex[c*2 + 1] = hexChars[rgba8[c]>>4];
+				hex[c*2 + 2] = hexChars[rgba8[c]&15];
+			}
+			hex[channels*2 + 1] = '\0';
+		}
+	};
+	ColourMap cmap{defaultCMap};
 
 	double dotCmapDepth = -0.85; // colour-map scaling - negative so that 0 is light, and not quite |1| so that it never gets to 100% white/black
 	
+	/// Hash of the values which affect layout (sizes, padding and the number of colours), so that a re-write can tell whether the previous layout is still valid
+	size_t layoutKey() const {
+		double values[] = {padding, tickH, tickV, labelSize, valueSize, titleSize, fontAspectRatio, textPadding, titlePadding, lineHeight, double(colours.size())};
+		uint64_t hash = 14695981039346656037ull; // FNV-1a
+		for (double v : values) {
+			uint64_t bits;
+			std::memcpy(&bits, &v, sizeof(bits));
+			for (int b = 0; b < 64; b += 8) {
+				hash = (hash ^ ((bits >> b)&255))*1099511628211ull;
+			}
+		}
+		return size_t(hash);
+	}
+
+	/** Increments when a change is detected to anything the CSS or `<defs>` depend on.
+		Since members can be changed directly, this compares (in place, without allocating) against a copy of those values whenever it's called, including on every write. */
+	size_t version() const {
+		return outputCache.version(*this);
+	}
+	/** Text generated from this style (e.g. compacted CSS), which is only regenerated when `.version()` changes or for a different `slot`/`key`.
+		The cache is shared with copies of this style, so figures copying the same style can re-use the results. */
+	std::shared_ptr<const std::string> cached(int slot, long long key, const std::function<std::string()> &generate) const {
+		return outputCache.get(*this, slot, key, generate);
+	}
+
 	// Make sure you have a copy, not a reference
 	PlotStyle copy() {
 		return *this;
 	}
+private:
+	/** Copying a style doesn't copy this, since the names are rebuilt when needed.
+		Only the latest table is kept.  The lock-free check compares the sizes packed into `key`, without reading the table, so a replaced table can be released immediately: any thread still reading the same (unchanged) style would also find that it doesn't match. */
+	class ClassNameCache {
+		std::atomic<size_t> key{0}; // 0 never matches
+		std::atomic<const ClassNames *> current{nullptr};
+		std::unique_ptr<const ClassNames> table;
+		std::mutex mutex;
+
+		// Packs the sizes which `ClassNames` depends on, or returns 0 if they don't fit
+		static size_t keyFor(const PlotStyle &style) {
+			static constexpr size_t bits = sizeof(size_t)*2, limit = (size_t(1) << bits) - 1;
+			size_t sizes[4] = {style.colours.size(), style.dashes.size(), style.hatches.size(), style.markers.size()};
+			size_t result = 0;
+			for (size_t s : sizes) {
+				if (s >= limit) return 0;
+				result = (result << bits) | (s + 1);
+			}
+			return result;
+		}
+	public:
+		ClassNameCache() {}
+		ClassNameCache(const ClassNameCache &) {}
+		ClassNameCache & operator=(const ClassNameCache &) {
+			return *this;
+		}
+
+		const ClassNames & get(const PlotStyle &style) {
+			size_t styleKey = keyFor(style);
+			if (styleKey && key.load(std::memory_order_acquire) == styleKey) {
+				return *current.load(std::memory_order_acquire);
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			if (table && table->matches(style)) return *table;
+			key.store(0, std::memory_order_release);
+			table.reset(new ClassNames(style));
+			current.store(table.get(), std::memory_order_release);
+			key.store(styleKey, std::memory_order_release);
+			return *table;
+		}
+	};
+	mutable ClassNameCache classNameCache;
+
+	/// Shared between copies of a style, and holds results for a few different sets of inputs
+	class OutputCache {
+		// Everything used by `.css()` and the `<defs>`
+		struct Inputs {
+			std::array<double, 9> values;
+			std::vector<std::string> colours, markers;
+			std::vector<std::vector<double>> dashes;
+			std::vector<Hatch> hatches;
+			std::string cssPrefix, cssSuffix;
+
+			static std::array<double, 9> valuesFrom(const PlotStyle &style) {
+				return {{style.lineWidth, style.fillOpacity, style.dotOpacity, style.labelSize, style.valueSize, style.titleSize, style.hatchWidth, style.hatchSpacing, style.markerSize}};
+			}
+			Inputs(const PlotStyle &style) : values(valuesFrom(style)), colours(style.colours), markers(style.markers), dashes(style.dashes), hatches(style.hatches), cssPrefix(style.cssPrefix), cssSuffix(style.cssSuffix) {}
+
+			bool matches(const PlotStyle &style) const {
+				if (values != valuesFrom(style) || colours != style.colours || markers != style.markers || dashes != style.dashes) return false;
+				if (cssPrefix != style.cssPrefix || cssSuffix != style.cssSuffix) return false;
+				if (hatches.size() != style.hatches.size()) return false;
+				for (size_t i = 0; i < hatches.size(); ++i) {
+					auto &a = hatches[i], &b = style.hatches[i];
+					if (a.angles != b.angles || a.lineScale != b.lineScale || a.spaceScale != b.spaceScale) return false;
+				}
+				return true;
+			}
+		};
+		struct Entry {
+			int slot;
+			long long key;
+			std::shared_ptr<const std::string> value;
+		};
+		struct InputSet {
+			Inputs inputs;
+			std::vector<Entry> entries; // most recent first
+			InputSet(const PlotStyle &style) : inputs(style) {}
+		};
+		static constexpr size_t maxInputSets = 8, maxEntries = 8;
+		struct Shared {
+			std::mutex mutex;
+			std::vector<std::shared_ptr<InputSet>> inputSets; // most recent first
+		};
+		std::shared_ptr<Shared> shared = std::make_shared<Shared>();
+		std::shared_ptr<InputSet> current;
+		size_t versionCounter = 0;
+
+		template<class T>
+		static void moveToFront(std::vector<T> &list, size_t index) {
+			std::rotate(list.begin(), list.begin() + index, list.begin() + index + 1);
+		}
+		// Called with the mutex held
+		InputSet & check(const PlotStyle &style) {
+			if (current && current->inputs.matches(style)) return *current;
+			auto &sets = shared->inputSets;
+			size_t index = 0;
+			while (index < sets.size() && !sets[index]->inputs.matches(style)) ++index;
+			if (index == sets.size()) {
+				sets.emplace_back(std::make_shared<InputSet>(style));
+				if (sets.size() > maxInputSets) sets.erase(sets.begin());
+				index = sets.size() - 1;
+			}
+			moveToFront(sets, index);
+			current = sets[0];
+			++versionCounter;
+			return *current;
+		}
+	public:
+		OutputCache() {}
+		OutputCache(const OutputCache &other) : shared(other.shared) {}
+		OutputCache & operator=(const OutputCache &other) {
+			shared = other.shared;
+			current = nullptr; // checked again next time, which increments the version
+			return *this;
+		}
+
+		size_t version(const PlotStyle &style) {
+			std::lock_guard<std::mutex> lock(shared->mutex);
+			check(style);
+			return versionCounter;
+		}
+		std::shared_ptr<const std::string> get(const PlotStyle &style, int slot, long long key, const std::function<std::string()> &generate) {
+			std::lock_guard<std::mutex> lock(shared->mutex);
+			auto &entries = check(style).entries;
+			for (size_t i = 0; i < entries.size(); ++i) {
+				if (entries[i].slot == slot && entries[i].key == key) {
+					moveToFront(entries, i);
+					return entries[0].value;
+				}
+			}
+			entries.insert(entries.begin(), Entry{slot, key, std::make_shared<const std::string>(generate())});
+			if (entries.size() > maxEntries) entries.pop_back();
+			return entries[0].value;
+		}
+	};
+	mutable OutputCache outputCache;
 };
 
 struct Bounds {
@@ -312,15 +677,687 @@ struct Point2D {
 	Point2D(double x, double y) : x(x), y(y) {}
 };
 
+/** Append-only output buffer, which is flushed (to a `std::ostream` by default) in large blocks.
+
+	Numbers are formatted directly into the buffer, instead of going through the (locale-aware) `std::ostream` formatting.  To send the output somewhere else, subclass this and override `.writeBlock()`.
+*/
+class SvgOutput {
+	std::ostream *stream = nullptr;
+	std::string buffer;
+	size_t flushedBytes = 0;
+	int holdCount = 0;
+	std::ostringstream numberStream; // uses the "C" locale, so SVG numbers always use `.` regardless of the global locale
+
+	static long long pow10(int power) {
+		static constexpr long long powers[19] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000, 10000000000, 100000000000, 1000000000000, 10000000000000, 100000000000000, 1000000000000000, 10000000000000000, 100000000000000000, 1000000000000000000};
+		return powers[power];
+	}
+	void writeDigits(unsigned long long u, int minDigits=1) {
+		char digits[24];
+		int length = 0;
+		while (u || length < minDigits) {
+			digits[length++] = char('0' + u%10);
+			u /= 10;
+		}
+		while (length > 0) buffer.push_back(digits[--length]);
+	}
+	SvgOutput & checkFlush() {
+		if (buffer.size() >= blockSize && !holdCount) flush();
+		return *this;
+	}
+	void writeStreamed(double v) {
+		if (v == 0) v = 0; // no "-0", to match the direct formatting
+		if (stream && !holdCount) {
+			flush();
+			(*stream) << v;
+		} else {
+			numberStream.str("");
+			numberStream << v;
+			append(numberStream.str());
+		}
+	}
+protected:
+	/// Called with each block of output
+	virtual void writeBlock(const char *data, size_t length) {
+		if (stream) stream->write(data, length);
+	}
+public:
+	/// The buffer is flushed when it reaches this size.  A size of 0 means every token is written immediately.
+	size_t blockSize;
+	/// Format numbers using `std::ostream` (slower, but respects custom stream formatting)
+	bool streamNumbers = false;
+
+	SvgOutput(size_t blockSize=65536) : blockSize(blockSize) {
+		buffer.reserve(blockSize);
+		numberStream.imbue(std::locale::classic());
+	}
+	SvgOutput(std::ostream &stream, size_t blockSize=65536) : SvgOutput(blockSize) {
+		this->stream = &stream;
+	}
+	virtual ~SvgOutput() {}
+	SvgOutput(const SvgOutput &other) = delete;
+	SvgOutput & operator=(const SvgOutput &other) = delete;
+
+	void flush() {
+		if (buffer.size()) writeBlock(buffer.data(), buffer.size());
+		flushedBytes += buffer.size();
+		buffer.clear();
+	}
+	/// Total bytes written (including any still in the buffer)
+	size_t bytes() const {
+		return flushedBytes + buffer.size();
+	}
+
+	/// While held (nestable), the buffer isn't flushed, so output since a `.heldPosition()` can be taken back out
+	void hold() {
+		++holdCount;
+	}
+	void release() {
+		if (holdCount > 0 && --holdCount == 0) checkFlush();
+	}
+	size_t heldPosition() const {
+		return buffer.size();
+	}
+	/// Removes and returns everything written since `position`
+	std::string takeHeld(size_t position) {
+		std::string result = buffer.substr(position);
+		buffer.resize(position);
+		return result;
+	}
+
+	SvgOutput & append(const char *data, size_t length) {
+		buffer.append(data, length);
+		return checkFlush();
+	}
+	SvgOutput & append(const std::string &str) {
+		return append(str.data(), str.size());
+	}
+	SvgOutput & append(char c) {
+		buffer.push_back(c);
+		return checkFlush();
+	}
+
+	SvgOutput & writeInt(long long v) {
+		if (v < 0) buffer.push_back('-');
+		writeDigits(v < 0 ? 0ull - (unsigned long long)v : (unsigned long long)v);
+		return checkFlush();
+	}
+	SvgOutput & writeInt(unsigned long long v) {
+		writeDigits(v);
+		return checkFlush();
+	}
+	/// Writes the fixed-point value `n/10^decimals`, using the fewest digits which represent it exactly
+	SvgOutput & writeFixed(long long n, int decimals) {
+		bool negative = (n < 0);
+		unsigned long long u = negative ? 0ull - (unsigned long long)n : (unsigned long long)n;
+		while (decimals > 0 && u%10 == 0) {
+			u /= 10;
+			--decimals;
+		}
+		if (negative && u) buffer.push_back('-');
+		if (decimals > 0) {
+			unsigned long long scale = pow10(decimals);
+			writeDigits(u/scale);
+			buffer.push_back('.');
+			writeDigits(u%scale, decimals);
+		} else {
+			writeDigits(u);
+		}
+		return checkFlush();
+	}
+	/// Writes a number, matching the default `std::ostream` format (6 significant figures)
+	SvgOutput & writeNumber(double v) {
+		if (streamNumbers) {
+			writeStreamed(v);
+			return *this;
+		}
+		double absV = std::abs(v);
+		if (v == 0) return append('0');
+		if (absV >= 1e-4 && absV < 999999.5) {
+			int exponent = (int)std::floor(std::log10(absV));
+			int decimals = std::max(0, 5 - exponent);
+			double scaled = absV*pow10(decimals);
+			double rounded = std::round(scaled);
+			// Near a rounding tie (or an extra digit from rounding up), we defer to the standard library
+			if (std::abs(std::abs(scaled - rounded) - 0.5) > 1e-6 && rounded >= 1e5 && rounded < 1e6) {
+				return writeFixed(v < 0 ? -(long long)rounded : (long long)rounded, decimals);
+			}
+		}
+		// Not `snprintf("%g")`, which depends on `LC_NUMERIC`
+		numberStream.str("");
+		numberStream << v;
+		return append(numberStream.str());
+	}
+
+	/// A null string writes nothing
+	SvgOutput & operator<<(const char *str) {
+		if (!str) return *this;
+		return append(str, std::strlen(str));
+	}
+	SvgOutput & operator<<(const std::string &str) {
+		return append(str);
+	}
+	SvgOutput & operator<<(char c) {
+		return append(c);
+	}
+	SvgOutput & operator<<(double v) {
+		return writeNumber(v);
+	}
+	SvgOutput & operator<<(float v) {
+		return writeNumber(v);
+	}
+	SvgOutput & operator<<(int v) {
+		return writeInt((long long)v);
+	}
+	SvgOutput & operator<<(long v) {
+		return writeInt((long long)v);
+	}
+	SvgOutput & operator<<(long long v) {
+		return writeInt(v);
+	}
+	SvgOutput & operator<<(unsigned v) {
+		return writeInt((unsigned long long)v);
+	}
+	SvgOutput & operator<<(unsigned long v) {
+		return writeInt((unsigned long long)v);
+	}
+	SvgOutput & operator<<(unsigned long long v) {
+		return writeInt(v);
+	}
+	/// Anything else goes through `std::ostream`
+	template<class V>
+	SvgOutput & operator<<(const V &v) {
+		numberStream.str("");
+		numberStream << v;
+		return append(numberStream.str());
+	}
+};
+
+/** `SvgOutput` which writes a gzip stream (e.g. for `.svgz` files), using a self-contained DEFLATE encoder.
+	Only a 32k window (plus one block) of uncompressed output is kept in memory.  The `level` is 0-9, where 0 writes uncompressed ("stored") blocks.
+*/
+class GzipOutput : public SvgOutput {
+	std::ostream &target;
+	int level;
+	int maxChain = 0, niceLength = 0, goodLength = 0, lazyLength = 0;
+	bool lazyMatching = false, finished = false;
+	size_t bytesIn = 0, bytesOut = 0;
+	double seconds = 0;
+	uint32_t crc = 0xFFFFFFFFu;
+
+	enum {windowSize = 32768, maxMatch = 258, hashSize = 32768};
+	std::vector<unsigned char> window; // history and pending input, starting at absolute position `windowStart`
+	size_t windowStart = 0, pos = 0, blockStart = 0, insertedUpTo = 0;
+	std::vector<size_t> head, prevChain; // hash chains, storing (position + 1)
+
+	std::vector<uint32_t> symbols; // literals, or `0x80000000u|(length<<16)|distance`
+	uint32_t litFreq[286], distFreq[30];
+
+	std::string compressed;
+	uint64_t bitBuffer = 0;
+	int bitCount = 0;
+
+	struct Tables {
+		uint16_t lengthBase[29], distBase[30];
+		uint8_t lengthExtra[29], distExtra[30];
+		uint8_t lengthCode[259], distCode[512];
+		uint32_t crc[256];
+		Tables() {
+			int length = 3;
+			for (int c = 0; c < 29; ++c) {
+				lengthExtra[c] = (c < 8 || c == 28) ? 0 : (c - 4)/4;
+				lengthBase[c] = (c == 28) ? 258 : length;
+				for (int i = 0; i < (1<<lengthExtra[c]) && length <= 258; ++i) lengthCode[length++] = c;
+			}
+			lengthCode[258] = 28;
+			int distance = 1;
+			for (int c = 0; c < 30; ++c) {
+				distExtra[c] = (c < 4) ? 0 : (c - 2)/2;
+				distBase[c] = distance;
+				for (int i = 0; i < (1<<distExtra[c]); ++i, ++distance) {
+					int d = distance - 1;
+					distCode[d < 256 ? d : 256 + (d>>7)] = c;
+				}
+			}
+			for (uint32_t i = 0; i < 256; ++i) {
+				uint32_t v = i;
+				for (int b = 0; b < 8; ++b) v = (v&1) ? (v>>1)^0xEDB88320u : (v>>1);
+				crc[i] = v;
+			}
+		}
+		int distanceCode(int distance) const {
+			int d = distance - 1;
+			return distCode[d < 256 ? d : 256 + (d>>7)];
+		}
+	};
+	static const Tables & tables() {
+		static Tables t;
+		return t;
+	}
+
+	// Huffman code lengths, limited to `maxBits` by flattening the frequencies until they fit
+	static void codeLengths(const uint32_t *freqs, int count, int maxBits, uint8_t *lengths) {
+		std::vector<int> used;
+		for (int i = 0; i < count; ++i) {
+			lengths[i] = 0;
+			if (freqs[i]) used.push_back(i);
+		}
+		if (used.size() < 2) { // always make a complete code with two symbols
+			int a = used.size() ? used[0] : 0;
+			lengths[a] = lengths[a ? 0 : 1] = 1;
+			return;
+		}
+		int n = int(used.size());
+		std::vector<uint64_t> weights(2*n - 1);
+		std::vector<int> parent(2*n - 1), depth(2*n - 1);
+		std::vector<uint32_t> scaled(freqs, freqs + count);
+		while (true) {
+			std::stable_sort(used.begin(), used.end(), [&](int a, int b) {
+				return scaled[a] < scaled[b];
+			});
+			for (int i = 0; i < n; ++i) weights[i] = scaled[used[i]];
+			// Two-queue construction: leaves (sorted) and internal nodes (created in order of weight)
+			int leaf = 0, node = n;
+			for (int next = n; next < 2*n - 1; ++next) {
+				int pair[2];
+				for (auto &child : pair) {
+					if (leaf < n && (node >= next || weights[leaf] <= weights[node])) {
+						child = leaf++;
+					} else {
+						child = node++;
+					}
+				}
+				weights[next] = weights[pair[0]] + weights[pair[1]];
+				parent[pair[0]] = parent[pair[1]] = next;
+			}
+			depth[2*n - 2] = 0;
+			int maxDepth = 0;
+			for (int i = 2*n - 3; i >= 0; --i) {
+				depth[i] = depth[parent[i]] + 1;
+				maxDepth = std::max(maxDepth, depth[i]);
+			}
+			if (maxDepth <= maxBits) {
+				for (int i = 0; i < n; ++i) lengths[used[i]] = depth[i];
+				return;
+			}
+			for (auto &f : scaled) f = (f + 1)/2;
+		}
+	}
+	// Canonical codes, bit-reversed because DEFLATE writes Huffman codes MSB-first
+	static void canonicalCodes(const uint8_t *lengths, int count, uint16_t *codes) {
+		int lengthCount[16] = {0}, nextCode[16] = {0};
+		for (int i = 0; i < count; ++i) ++lengthCount[lengths[i]];
+		lengthCount[0] = 0;
+		int code = 0;
+		for (int bits = 1; bits < 16; ++bits) {
+			code = (code + lengthCount[bits - 1])<<1;
+			nextCode[bits] = code;
+		}
+		for (int i = 0; i < count; ++i) {
+			int bits = lengths[i], c = bits ? nextCode[bits]++ : 0, reversed = 0;
+			for (int b = 0; b < bits; ++b) reversed |= ((c>>b)&1)<<(bits - 1 - b);
+			codes[i] = reversed;
+		}
+	}
+
+	void writeBits(uint32_t value, int bits) {
+		bitBuffer |= uint64_t(value)<<bitCount;
+		bitCount += bits;
+		while (bitCount >= 8) {
+			compressed.push_back(char(bitBuffer&0xFF));
+			bitBuffer >>= 8;
+			bitCount -= 8;
+		}
+	}
+	void alignToByte() {
+		if (bitCount) writeBits(0, 8 - bitCount);
+	}
+	void writeCompressed() {
+		target.write(compressed.data(), compressed.size());
+		bytesOut += compressed.size();
+		compressed.clear();
+	}
+
+	static int hash(const unsigned char *data) {
+		uint32_t v = (uint32_t(data[0])<<16)|(uint32_t(data[1])<<8)|data[2];
+		return (v*2654435761u)>>17; // 15 bits
+	}
+	void insertUpTo(size_t p) {
+		size_t end = windowStart + window.size();
+		while (insertedUpTo < p && insertedUpTo + 3 <= end) {
+			int h = hash(&window[insertedUpTo - windowStart]);
+			prevChain[insertedUpTo&(windowSize - 1)] = head[h];
+			head[h] = ++insertedUpTo;
+		}
+	}
+	void findMatch(size_t p, size_t &bestLength, size_t &bestDistance) {
+		bestLength = bestDistance = 0;
+		size_t maxLength = std::min(size_t(maxMatch), windowStart + window.size() - p);
+		if (maxLength < 3) return;
+		const unsigned char *current = &window[p - windowStart];
+		size_t link = head[hash(current)];
+		for (int chain = maxChain; link && chain > 0; --chain) {
+			size_t candidate = link - 1;
+			if (p - candidate > size_t(windowSize) || candidate < windowStart) break;
+			const unsigned char *prior = &window[candidate - windowStart];
+			if (prior[bestLength] == current[bestLength] && prior[0] == current[0] && prior[1] == current[1]) {
+				size_t length = 2;
+				while (length < maxLength && prior[length] == current[length]) ++length;
+				if (length > bestLength) {
+					bestLength = length;
+					bestDistance = p - candidate;
+					if (length >= size_t(niceLength) || length == maxLength) break;
+				}
+			}
+			link = prevChain[candidate&(windowSize - 1)];
+		}
+		if (bestLength < 3) bestLength = bestDistance = 0;
+	}
+
+	void addLiteral(unsigned char c) {
+		symbols.push_back(c);
+		++litFreq[c];
+	}
+	void addMatch(size_t length, size_t distance) {
+		symbols.push_back(0x80000000u|uint32_t(length<<16)|uint32_t(distance));
+		++litFreq[257 + tables().lengthCode[length]];
+		++distFreq[tables().distanceCode(int(distance))];
+	}
+
+	void compress(bool isFinal) {
+		size_t end = windowStart + window.size();
+		size_t limit = isFinal ? end : (end >= pos + maxMatch ? end - size_t(maxMatch) : pos);
+		if (level == 0) {
+			pos = std::max(pos, limit);
+		} else {
+			size_t cachedPos = size_t(-1), cachedLength = 0, cachedDistance = 0;
+			while (pos < limit) {
+				size_t length, distance;
+				insertUpTo(pos);
+				if (pos == cachedPos) {
+					length = cachedLength;
+					distance = cachedDistance;
+				} else {
+					findMatch(pos, length, distance);
+				}
+				if (lazyMatching && length && length < size_t(lazyLength) && pos + 1 < limit) {
+					// Check whether starting one byte later would give a longer match (searching less if this one's already good)
+					int chain = maxChain;
+					if (length >= size_t(goodLength)) maxChain = std::max(1, maxChain/4);
+					insertUpTo(pos + 1);
+					findMatch(pos + 1, cachedLength, cachedDistance);
+					maxChain = chain;
+					cachedPos = pos + 1;
+					if (cachedLength > length) length = 0;
+				}
+				if (length) {
+					addMatch(length, distance);
+					pos += length;
+					// Without lazy matching, skip indexing inside long matches
+					if (!lazyMatching && length > size_t(lazyLength)) insertedUpTo = std::max(insertedUpTo, pos);
+				} else {
+					addLiteral(window[pos - windowStart]);
+					++pos;
+				}
+			}
+		}
+		if (pos > blockStart || isFinal) writeDeflateBlock(isFinal);
+
+		// Drop history we no longer need
+		if (pos - windowStart > size_t(2*windowSize)) {
+			size_t drop = pos - windowSize - windowStart;
+			window.erase(window.begin(), window.begin() + drop);
+			windowStart += drop;
+		}
+		if (compressed.size() >= 65536 || isFinal) writeCompressed();
+	}
+
+	void writeDeflateBlock(bool isFinal) {
+		const Tables &t = tables();
+		size_t rawLength = pos - blockStart;
+		litFreq[256] = 1; // end-of-block
+
+		uint8_t litLengths[286], distLengths[30];
+		codeLengths(litFreq, 286, 15, litLengths);
+		codeLengths(distFreq, 30, 15, distLengths);
+		int litCount = 286, distCount = 30;
+		while (litCount > 257 && !litLengths[litCount - 1]) --litCount;
+		while (distCount > 1 && !distLengths[distCount - 1]) --distCount;
+
+		// Run-length encode the code lengths
+		uint8_t allLengths[316];
+		std::memcpy(allLengths, litLengths, litCount);
+		std::memcpy(allLengths + litCount, distLengths, distCount);
+		int allCount = litCount + distCount;
+		std::vector<uint16_t> lengthSymbols; // symbol + (extra bits)<<8
+		uint32_t lengthFreq[19] = {0};
+		for (int i = 0; i < allCount;) {
+			int value = allLengths[i], run = 1;
+			while (i + run < allCount && allLengths[i + run] == value) ++run;
+			i += run;
+			if (value == 0) {
+				while (run >= 11) {
+					int r = std::min(run, 138);
+					lengthSymbols.push_back(18 + ((r - 11)<<8));
+					run -= r;
+				}
+				if (run >= 3) {
+					lengthSymbols.push_back(17 + ((run - 3)<<8));
+					run = 0;
+				}
+			} else {
+				lengthSymbols.push_back(value);
+				--run;
+				while (run >= 3) {
+					int r = std::min(run, 6);
+					lengthSymbols.push_back(16 + ((r - 3)<<8));
+					run -= r;
+				}
+			}
+			while (run-- > 0) lengthSymbols.push_back(value);
+		}
+		for (auto s : lengthSymbols) ++lengthFreq[s&0xFF];
+		uint8_t lengthLengths[19];
+		codeLengths(lengthFreq, 19, 7, lengthLengths);
+		static const uint8_t lengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+		int lengthCount = 19;
+		while (lengthCount > 4 && !lengthLengths[lengthOrder[lengthCount - 1]]) --lengthCount;
+
+		// Compare the sizes of each block type
+		auto dataBits = [&](const uint8_t *lit, const uint8_t *dist) {
+			uint64_t bits = 0;
+			for (int i = 0; i < 286; ++i) bits += uint64_t(litFreq[i])*lit[i];
+			for (int i = 0; i < 29; ++i) bits += uint64_t(litFreq[257 + i])*t.lengthExtra[i];
+			for (int i = 0; i < 30; ++i) bits += uint64_t(distFreq[i])*(dist[i] + t.distExtra[i]);
+			return bits;
+		};
+		uint64_t dynamicBits = 17 + 3*lengthCount + dataBits(litLengths, distLengths);
+		for (auto s : lengthSymbols) {
+			int symbol = s&0xFF;
+			dynamicBits += lengthLengths[symbol] + (symbol == 16 ? 2 : symbol == 17 ? 3 : symbol == 18 ? 7 : 0);
+		}
+		uint8_t fixedLit[288], fixedDist[30];
+		for (int i = 0; i < 288; ++i) fixedLit[i] = (i < 144) ? 8 : (i < 256) ? 9 : (i < 280) ? 7 : 8;
+		for (int i = 0; i < 30; ++i) fixedDist[i] = 5;
+		uint64_t fixedBits = 3 + dataBits(fixedLit, fixedDist);
+		uint64_t storedBits = (rawLength/65535 + 1)*(3 + 7 + 32) + 8*uint64_t(rawLength);
+
+		if (level == 0 || (storedBits < fixedBits && storedBits < dynamicBits)) {
+			const unsigned char *data = &window[blockStart - windowStart];
+			do {
+				size_t length = std::min(rawLength, size_t(65535));
+				rawLength -= length;
+				writeBits((isFinal && !rawLength) ? 1 : 0, 3);
+				alignToByte();
+				writeBits(uint32_t(length), 16);
+				writeBits(uint32_t(length^0xFFFF), 16);
+				compressed.append((const char *)data, length);
+				data += length;
+			} while (rawLength);
+		} else {
+			uint16_t litCodes[288], distCodes[30];
+			const uint8_t *lit = litLengths, *dist = distLengths;
+			if (fixedBits <= dynamicBits) {
+				writeBits(isFinal ? 3 : 2, 3);
+				lit = fixedLit;
+				dist = fixedDist;
+				canonicalCodes(lit, 288, litCodes);
+			} else {
+				writeBits(isFinal ? 5 : 4, 3);
+				writeBits(litCount - 257, 5);
+				writeBits(distCount - 1, 5);
+				writeBits(lengthCount - 4, 4);
+				for (int i = 0; i < lengthCount; ++i) writeBits(lengthLengths[lengthOrder[i]], 3);
+				uint16_t lengthCodes[19];
+				canonicalCodes(lengthLengths, 19, lengthCodes);
+				for (auto s : lengthSymbols) {
+					int symbol = s&0xFF, extra = s>>8;
+					writeBits(lengthCodes[symbol], lengthLengths[symbol]);
+					if (symbol >= 16) writeBits(extra, symbol == 16 ? 2 : symbol == 17 ? 3 : 7);
+				}
+				canonicalCodes(lit, 286, litCodes);
+			}
+			canonicalCodes(dist, 30, distCodes);
+			for (auto s : symbols) {
+				if (s&0x80000000u) {
+					int length = (s>>16)&0x1FF, distance = s&0xFFFF;
+					int lc = t.lengthCode[length], dc = t.distanceCode(distance);
+					writeBits(litCodes[257 + lc], lit[257 + lc]);
+					writeBits(length - t.lengthBase[lc], t.lengthExtra[lc]);
+					writeBits(distCodes[dc], dist[dc]);
+					writeBits(distance - t.distBase[dc], t.distExtra[dc]);
+				} else {
+					writeBits(litCodes[s], lit[s]);
+				}
+			}
+			writeBits(litCodes[256], lit[256]);
+		}
+		symbols.clear();
+		std::memset(litFreq, 0, sizeof(litFreq));
+		std::memset(distFreq, 0, sizeof(distFreq));
+		blockStart = pos;
+	}
+protected:
+	void writeBlock(const char *data, size_t length) override {
+		auto startTime = std::chrono::steady_clock::now();
+		const Tables &t = tables();
+		for (size_t i = 0; i < length; ++i) {
+			crc = t.crc[(crc^(unsigned char)data[i])&0xFF]^(crc>>8);
+		}
+		bytesIn += length;
+		window.insert(window.end(), (const unsigned char *)data, (const unsigned char *)data + length);
+		if (windowStart + window.size() - pos >= size_t(65536 + maxMatch)) compress(false);
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	}
+public:
+	GzipOutput(std::ostream &stream, int level=6, size_t blockSize=65536) : SvgOutput(blockSize), target(stream), level(std::max(0, std::min(9, level))), head(hashSize, 0), prevChain(windowSize, 0) {
+		// Same trade-offs between search effort and compression as zlib
+		static const int chains[10] = {0, 4, 8, 32, 16, 32, 128, 256, 1024, 4096};
+		static const int nice[10] = {0, 8, 16, 32, 16, 32, 128, 128, 258, 258};
+		static const int good[10] = {0, 4, 4, 4, 4, 8, 8, 8, 32, 32};
+		static const int lazy[10] = {0, 4, 5, 6, 4, 16, 16, 32, 128, 258}; // for levels 1-3, the longest match which is indexed
+		maxChain = chains[this->level];
+		niceLength = nice[this->level];
+		goodLength = good[this->level];
+		lazyLength = lazy[this->level];
+		lazyMatching = (this->level >= 4);
+		std::memset(litFreq, 0, sizeof(litFreq));
+		std::memset(distFreq, 0, sizeof(distFreq));
+		// gzip header: magic, DEFLATE, no flags/timestamp, unknown OS
+		compressed.append("\x1f\x8b\x08\0\0\0\0\0\0\xff", 10);
+	}
+	~GzipOutput() {
+		finish();
+	}
+
+	/// Compresses any remaining output, and ends the gzip stream
+	void finish() {
+		if (finished) return;
+		flush();
+		auto startTime = std::chrono::steady_clock::now();
+		compress(true);
+		alignToByte();
+		uint32_t checksum = crc^0xFFFFFFFFu, size = uint32_t(bytesIn);
+		for (int i = 0; i < 4; ++i) compressed.push_back(char((checksum>>(i*8))&0xFF));
+		for (int i = 0; i < 4; ++i) compressed.push_back(char((size>>(i*8))&0xFF));
+		writeCompressed();
+		target.flush();
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		finished = true;
+	}
+	/// Uncompressed bytes received so far
+	size_t inputBytes() const {
+		return bytesIn;
+	}
+	/// Compressed bytes written so far (complete after `.finish()`)
+	size_t outputBytes() const {
+		return bytesOut;
+	}
+	/// Time spent compressing
+	double compressSeconds() const {
+		return seconds;
+	}
+};
+
+/// `SvgOutput` which collects everything into a string
+class SvgStringOutput : public SvgOutput {
+	std::string collected;
+protected:
+	void writeBlock(const char *data, size_t length) override {
+		collected.append(data, length);
+	}
+public:
+	SvgStringOutput(size_t blockSize=65536) : SvgOutput(blockSize) {}
+
+	const std::string & str() {
+		flush();
+		return collected;
+	}
+};
+
 /// Internal helper class for slightly more semantic code when writing SVGs
 class SvgWriter {
-	std::ostream &output;
+	std::unique_ptr<SvgOutput> ownedOutput;
+	SvgOutput &output;
 	std::vector<Bounds> clipStack;
 	long idCounter = 0;
+	bool deferIds = false; // element IDs are written as placeholders, and numbered when merged into the parent writer
 	double precision, invPrecision;
+	int precisionDecimals = -1; // if the precision is an exact power of 10, we write co-ordinates as fixed-point
+
+	void setPrecision(double p) {
+		precision = p;
+		invPrecision = simplifyError = 1/p;
+		precisionDecimals = -1;
+		double power = 1;
+		for (int d = 0; d < 10; ++d) {
+			if (power == p) precisionDecimals = d;
+			power *= 10;
+		}
+	}
 public:
-	SvgWriter(std::ostream &output, Bounds bounds, double precision) : output(output), clipStack({bounds}), precision(precision), invPrecision(1.0/precision) {}
-	
+	SvgWriter(SvgOutput &output, Bounds bounds, double precision) : output(output), clipStack({bounds}) {
+		setPrecision(precision);
+	}
+	SvgWriter(std::ostream &stream, Bounds bounds, double precision) : ownedOutput(new SvgOutput(stream)), output(*ownedOutput), clipStack({bounds}) {
+		setPrecision(precision);
+	}
+	/// Writer for a separate part of the output (e.g. written on another thread), with the same settings as `parent`.  Its output should be added using `parent.merge()`.
+	SvgWriter(SvgOutput &output, const SvgWriter &parent) : output(output), clipStack(parent.clipStack), deferIds(true) {
+		setPrecision(parent.precision);
+		simplify = parent.simplify;
+		simplifyError = parent.simplifyError;
+		pathEncoding = parent.pathEncoding;
+		defsHref = parent.defsHref;
+	}
+	~SvgWriter() {
+		output.flush();
+	}
+
+	SvgOutput & rawOutput() {
+		return output;
+	}
+
 	SvgWriter & raw() {
 		return *this;
 	}
@@ -335,11 +1372,17 @@ public:
 	}
 	template<class First, class ...Args>
 	SvgWriter & write(First &&v, Args &&...args) {
-		// Only strings get escaped
-		return raw(v).write(args...);
+		writeValue(v);
+		return write(args...);
 	}
-	template<class ...Args>
-	SvgWriter & write(const char *str, Args &&...args) {
+private:
+	// Only strings get escaped
+	template<class V>
+	void writeValue(const V &v) {
+		raw(v);
+	}
+	void writeValue(const char *str) {
+		if (!str) return;
 		while (*str) {
 			if (*str == '<') {
 				output << "&lt;";
@@ -352,12 +1395,12 @@ public:
 			}
 			++str;
 		}
-		return write(args...);
 	}
-	template<class ...Args>
-	SvgWriter & write(std::string str, Args &&...args) {
-		return write(str.c_str(), args...);
+	// By reference, so (for example) class names from `PlotStyle` aren't copied
+	void writeValue(const std::string &str) {
+		writeValue(str.c_str());
 	}
+public:
 	
 	template<class ...Args>
 	SvgWriter & attr(const char *name, Args &&...args) {
@@ -380,8 +1423,31 @@ public:
 	}
 	
 	std::string elementId(std::string prefix) {
+		if (deferIds) return prefix + '\x01' + std::to_string(idCounter++) + '\x02';
 		return prefix + std::to_string(idCounter++);
 	}
+	/// Adds the output from a separate writer (see above), numbering its element IDs as if it had been written here directly
+	SvgWriter & merge(const std::string &partOutput, const SvgWriter &part) {
+		const char *data = partOutput.c_str(), *end = data + partOutput.size();
+		while (data < end) {
+			const char *marker = (const char *)std::memchr(data, '\x01', end - data);
+			if (!marker) {
+				output.append(data, end - data);
+				break;
+			}
+			output.append(data, marker - data);
+			char *idEnd;
+			long id = idCounter + std::strtol(marker + 1, &idEnd, 10);
+			if (deferIds) {
+				output << '\x01' << id << '\x02';
+			} else {
+				output << id;
+			}
+			data = idEnd + 1;
+		}
+		idCounter += part.idCounter;
+		return *this;
+	}
 	
 	/// XML tag helper, closing the tag when it's destroyed
 	struct Tag {
@@ -423,6 +1489,22 @@ public:
 	double round(double v) {
 		return std::round(v*precision)*invPrecision;
 	};
+	/// Writes a value rounded to the precision, using the shortest representation
+	SvgWriter & rawRounded(double v) {
+		double scaled = std::round(v*precision);
+		if (precisionDecimals >= 0 && !output.streamNumbers && std::abs(scaled) < 1e15) {
+			output.writeFixed((long long)scaled, precisionDecimals);
+		} else {
+			output << scaled*invPrecision;
+		}
+		return *this;
+	}
+	SvgWriter & rawPoint(double x, double y) {
+		output << ' ';
+		rawRounded(x);
+		output << ' ';
+		return rawRounded(y);
+	}
 
 	bool animated = false;
 	enum class PointState {start, outOfBounds, singlePoint, pendingLine};
@@ -430,20 +1512,136 @@ public:
 	char outOfBoundsMask = 0; // tracks which direction(s) we are out of bounds
 	Point2D lastDrawn, prevPoint;
 	double totalPendingError = 0;
-	void startPath() {
+
+	/// Which points `.addPoint()` can drop along almost-straight lines
+	PlotStyle::Simplify simplify = PlotStyle::Simplify::accumulated;
+	/// Maximum distance of any dropped point from the drawn path, for `Simplify::maxError`
+	double simplifyError = 0;
+	/// How `.addPoint()` writes co-ordinates
+	PlotStyle::PathEncoding pathEncoding = PlotStyle::PathEncoding::absolute;
+	/// Prefix for references to the style's `<defs>` (e.g. markers), which is empty unless they're in a separate file
+	std::string defsHref;
+	/// Writes the attributes a `<path>` needs for the current `pathEncoding`
+	SvgWriter & pathAttrs() {
+		if (pathEncoding == PlotStyle::PathEncoding::scaledInteger) {
+			attr("transform", "scale(", invPrecision, ")").attr("vector-effect", "non-scaling-stroke");
+		}
+		return *this;
+	}
+	/** Starts a new path.
+		With `clipSegments`, any part of the path outside the clip bounds is replaced by its projection onto the boundary, with extra points where it crosses the edges.  This keeps fills correct, but can change the number of points, so it should be disabled when interpolating between animation frames. */
+	void startPath(bool clipSegments=true) {
 		endPath();
 		outOfBoundsMask = 0;
 		prevPoint.x = prevPoint.y = -1e300;
+		clipActive = clipSegments;
+		pathPointIndex = 0;
+		pathAfterCommand = true;
 		raw("M");
 	}
 	void endPath() {
+		if (clipActive && clipHasPrev && clipPrevRegion) {
+			// Finish on the boundary
+			const Bounds &clip = clipStack.back();
+			clippedPoint(clip, clipPrev.x, clipPrev.y, false);
+		}
+		clipHasPrev = clipHasForwarded = false;
 		if (pointState == PointState::pendingLine) {
-			raw(" ", round(prevPoint.x), " ", round(prevPoint.y));
+			pathPoint(prevPoint.x, prevPoint.y);
 		}
 		pointState = PointState::start;
 	}
 	void addPoint(double x, double y, bool alwaysInclude=false) {
 		if (std::isnan(x) || std::isnan(y)) return;
+		if (!clipActive) return addVertex(x, y, alwaysInclude);
+
+		const Bounds &clip = clipStack.back();
+		int region = clipRegion(clip, x, y);
+		if (!clipHasPrev) {
+			clippedPoint(clip, x, y, alwaysInclude);
+		} else if (region != clipPrevRegion) {
+			// Add points (on the boundary) wherever the segment crosses one of the clip edges, in order
+			double dx = x - clipPrev.x, dy = y - clipPrev.y;
+			double crossings[4];
+			int crossingCount = 0;
+			auto addCrossing = [&](double t) {
+				if (!(t > 0 && t < 1)) return;
+				int i = crossingCount++;
+				for (; i > 0 && crossings[i - 1] > t; --i) crossings[i] = crossings[i - 1];
+				crossings[i] = t;
+			};
+			if (dx != 0) {
+				addCrossing((clip.left - clipPrev.x)/dx);
+				addCrossing((clip.right - clipPrev.x)/dx);
+			}
+			if (dy != 0) {
+				addCrossing((clip.top - clipPrev.y)/dy);
+				addCrossing((clip.bottom - clipPrev.y)/dy);
+			}
+			for (int i = 0; i < crossingCount; ++i) {
+				double t = crossings[i];
+				clippedPoint(clip, clipPrev.x + dx*t, clipPrev.y + dy*t, false);
+			}
+			if (region == 0 || crossingCount == 0) clippedPoint(clip, x, y, alwaysInclude);
+		} else if (region == 0 || alwaysInclude) {
+			clippedPoint(clip, x, y, alwaysInclude);
+		} // otherwise, we're still outside the same edge/corner, and don't need to draw anything
+		clipPrev = {x, y};
+		clipPrevRegion = region;
+		clipHasPrev = true;
+	}
+private:
+	long long pathX = 0, pathY = 0; // previous point (for relative encodings), in units of `invPrecision`
+	int pathPointIndex = 0;
+	bool pathAfterCommand = false;
+	void pathNumber(long long n) {
+		if (n >= 0 && !pathAfterCommand) output << ' ';
+		pathAfterCommand = false;
+		if (pathEncoding == PlotStyle::PathEncoding::scaledInteger) {
+			output.writeInt(n);
+		} else if (precisionDecimals >= 0 && !output.streamNumbers) {
+			output.writeFixed(n, precisionDecimals);
+		} else {
+			output << n*invPrecision;
+		}
+	}
+	void pathPoint(double x, double y) {
+		if (pathEncoding == PlotStyle::PathEncoding::absolute) {
+			rawPoint(x, y);
+			return;
+		}
+		long long qx = std::llround(std::max(-1e15, std::min(1e15, x*precision)));
+		long long qy = std::llround(std::max(-1e15, std::min(1e15, y*precision)));
+		if (pathPointIndex++ == 0) {
+			pathNumber(qx);
+			pathNumber(qy);
+		} else {
+			if (pathPointIndex == 2) {
+				output << 'l';
+				pathAfterCommand = true;
+			}
+			pathNumber(qx - pathX);
+			pathNumber(qy - pathY);
+		}
+		pathX = qx;
+		pathY = qy;
+	}
+	bool clipActive = false, clipHasPrev = false, clipHasForwarded = false;
+	int clipPrevRegion = 0;
+	Point2D clipPrev, clipForwarded;
+	static int clipRegion(const Bounds &clip, double x, double y) {
+		return (clip.left > x) | (2*(clip.right < x)) | (4*(clip.top > y)) | (8*(clip.bottom < y));
+	}
+	// Projects a point onto the clip bounds, and adds it if it's not a duplicate
+	void clippedPoint(const Bounds &clip, double x, double y, bool alwaysInclude) {
+		x = std::max(clip.left, std::min(clip.right, x));
+		y = std::max(clip.top, std::min(clip.bottom, y));
+		if (clipHasForwarded && clipForwarded.x == x && clipForwarded.y == y) return;
+		clipForwarded = {x, y};
+		clipHasForwarded = true;
+		addVertex(x, y, alwaysInclude);
+	}
+	void addVertex(double x, double y, bool alwaysInclude) {
 		auto clip = clipStack.back();
 		/// Bitmask indicating which direction(s) the point is outside the bounds
 		char mask = (clip.left > x)
@@ -455,13 +1653,23 @@ public:
 		if (!outOfBoundsMask) {
 			if (pointState == PointState::outOfBounds) {
 				// Draw the most recent out-of-bounds point
-				raw(" ", round(prevPoint.x), " ", round(prevPoint.y));
+				pathPoint(prevPoint.x, prevPoint.y);
 				lastDrawn = prevPoint;
 				pointState = PointState::singlePoint;
 			}
 			if (pointState == PointState::singlePoint) {
 				pointState = PointState::pendingLine;
 				totalPendingError = 0;
+				sleeveReset();
+				sleeveAdd(x, y);
+			} else if (pointState == PointState::pendingLine && simplify == PlotStyle::Simplify::maxError) {
+				if (!sleeveContains(x, y)) {
+					// A line to the current point would be too far from one of the pending points
+					pathPoint(prevPoint.x, prevPoint.y);
+					lastDrawn = prevPoint;
+					sleeveReset();
+				}
+				sleeveAdd(x, y);
 			} else if (pointState == PointState::pendingLine) {
 				// Approximate the pending point as being on the line from last-drawn point -> current
 				double d1 = std::hypot(prevPoint.x - lastDrawn.x, prevPoint.y - lastDrawn.y);
@@ -473,47 +1681,156 @@ public:
 				totalPendingError += std::hypot(extX - prevPoint.x, extY - prevPoint.y);
 				if (totalPendingError > invPrecision) {
 					// Would be too much accumulated error.  Draw the pending segment, and start a new one.
-					raw(" ", round(prevPoint.x), " ", round(prevPoint.y));
+					pathPoint(prevPoint.x, prevPoint.y);
 					lastDrawn = prevPoint;
 					totalPendingError = 0;
 				}
 			} else { // start
-				raw(" ", round(x), " ", round(y));
+				pathPoint(x, y);
 				lastDrawn = {x, y};
 				pointState = PointState::singlePoint;
 			}
 			outOfBoundsMask = mask;
 			if (outOfBoundsMask && pointState != PointState::start) {
-				if (pointState == PointState::pendingLine) {
-					raw(" ", round(prevPoint.x), " ", round(prevPoint.y));
+				if (pointState == PointState::pendingLine && (lastDrawn.x != prevPoint.x || lastDrawn.y != prevPoint.y)) {
+					pathPoint(prevPoint.x, prevPoint.y);
 				}
-				raw(" ", round(x), " ", round(y)); // Draw the first out-of-bounds point
+				pathPoint(x, y); // Draw the first out-of-bounds point
 				pointState = PointState::outOfBounds;
 			}
 		}
 		prevPoint = {x, y};
 	}
+	/* For `Simplify::maxError`: the cone of directions (from `lastDrawn`) which keeps every pending point within `simplifyError` of a line.
+	A bounded window of pending points is also kept, so that when the next point is closer than some of them, we can check they're still close to the end of the segment (instead of always starting a new one). */
+	Point2D sleeveLow, sleeveHigh;
+	bool sleeveOpen = true, sleeveEmpty = false, sleeveOverflow = false;
+	double sleeveDistance2 = 0;
+	std::vector<Point2D> sleevePoints; // relative to `lastDrawn`
+	static constexpr size_t sleeveWindow = 64;
+	static double cross(const Point2D &a, const Point2D &b) {
+		return a.x*b.y - a.y*b.x;
+	}
+	void sleeveReset() {
+		sleeveOpen = true;
+		sleeveEmpty = sleeveOverflow = false;
+		sleeveDistance2 = 0;
+		sleevePoints.clear();
+	}
+	bool sleeveContains(double x, double y) const {
+		Point2D d{x - lastDrawn.x, y - lastDrawn.y};
+		if (sleeveEmpty) return false;
+		if (!sleeveOpen && (cross(sleeveLow, d) < 0 || cross(d, sleeveHigh) < 0)) return false;
+		double d2 = d.x*d.x + d.y*d.y;
+		if (d2 >= sleeveDistance2) return true;
+		if (sleeveOverflow) return false;
+		// Pending points past the end of the segment must be close to the end-point
+		double error2 = simplifyError*simplifyError;
+		for (auto &p : sleevePoints) {
+			if (p.x*d.x + p.y*d.y > d2) {
+				double ex = p.x - d.x, ey = p.y - d.y;
+				if (ex*ex + ey*ey > error2) return false;
+			}
+		}
+		return true;
+	}
+	void sleeveAdd(double x, double y) {
+		double dx = x - lastDrawn.x, dy = y - lastDrawn.y;
+		double d2 = dx*dx + dy*dy;
+		if (d2 <= simplifyError*simplifyError) return; // any line from `lastDrawn` is close enough
+		if (sleevePoints.size() < sleeveWindow) {
+			sleevePoints.push_back({dx, dy});
+		} else {
+			sleeveOverflow = true;
+		}
+		sleeveDistance2 = std::max(sleeveDistance2, d2);
+		double d = std::sqrt(d2);
+		double sin = simplifyError/d, cos = std::sqrt(1 - sin*sin);
+		double ux = dx/d, uy = dy/d;
+		Point2D low{ux*cos + uy*sin, uy*cos - ux*sin}, high{ux*cos - uy*sin, uy*cos + ux*sin};
+		if (sleeveOpen) {
+			sleeveLow = low;
+			sleeveHigh = high;
+			sleeveOpen = false;
+		} else {
+			if (cross(sleeveLow, low) > 0) sleeveLow = low;
+			if (cross(high, sleeveHigh) > 0) sleeveHigh = high;
+			if (cross(sleeveLow, sleeveHigh) < 0) sleeveEmpty = true;
+		}
+	}
+public:
 	
+	/// Hex colour from the latest `.translateCmap()`
 	char cmapStr[10] = "";
+	/// Dots use the exact colour-map value (not the table), since there are relatively few of them
 	void translateCmap(const PlotStyle &style, double v) {
-		double rgba[4] = {v, v, v, 1};
-		style.cmap(v, rgba);
-		uint8_t rgba8[4];
-		for (size_t c = 0; c < 4; ++c) {
-			rgba8[c] = (uint8_t) std::round(255*std::max(0.0, std::min(1.0, rgba[c])));
-		}
+		style.cmap.exactHex(v, cmapStr);
+	}
+};
 
-		static constexpr const char *hexChars = "0123456789ABCDEF";
-		size_t channels = (rgba8[3] < 255) ? 4 : 3;
-		
-		// Translate to RGB(A) hex representation
-		cmapStr[0] = '#';
-		for (size_t c = 0; c < channels; ++c) {
-			uint8_t byte = rgba8[c];
-			cmapStr[c*2 + 1] = hexChars[byte>>4];
-			cmapStr[c*2 + 2] = hexChars[byte&15];
-			cmapStr[c*2 + 3] = '\0';
+/** Memory for drawable elements, allocated in large blocks instead of one heap allocation per element.
+
+	Freed elements (e.g. labels from a previous layout) are recycled for later ones of the same size, and everything is released together when the arena is destroyed.  It's not thread-safe, but elements are only created while building or laying out a diagram, not while writing.
+*/
+class DrawableArena {
+	static constexpr size_t align = alignof(std::max_align_t);
+	size_t blockBytes;
+	std::vector<void *> blocks;
+	char *nextFree = nullptr;
+	size_t remaining = 0;
+	std::vector<void *> freeLists; // indexed by size/align, linked through the first bytes of each freed element
+	size_t allocCount = 0, blockAllocCount = 0, totalBytes = 0;
+public:
+	DrawableArena(size_t blockBytes=65536) : blockBytes(blockBytes) {}
+	~DrawableArena() {
+		for (void *block : blocks) ::operator delete(block);
+	}
+	DrawableArena(const DrawableArena &other) = delete;
+	DrawableArena & operator =(const DrawableArena &other) = delete;
+
+	void * allocate(size_t size) {
+		size = (size + align - 1)/align*align;
+		++allocCount;
+		size_t sizeIndex = size/align;
+		if (sizeIndex < freeLists.size() && freeLists[sizeIndex]) {
+			void *ptr = freeLists[sizeIndex];
+			std::memcpy(&freeLists[sizeIndex], ptr, sizeof(void *));
+			return ptr;
+		}
+		if (size > remaining) {
+			// Oversized elements get their own block, so the current one keeps being used
+			size_t bytes = std::max(size, blockBytes);
+			char *block = (char *)::operator new(bytes);
+			blocks.push_back(block);
+			++blockAllocCount;
+			totalBytes += bytes;
+			if (bytes == size) return block;
+			nextFree = block;
+			remaining = bytes;
 		}
+		void *ptr = nextFree;
+		nextFree += size;
+		remaining -= size;
+		return ptr;
+	}
+	void release(void *ptr, size_t size) {
+		size = (size + align - 1)/align*align;
+		size_t sizeIndex = size/align;
+		if (sizeIndex >= freeLists.size()) freeLists.resize(sizeIndex + 1, nullptr);
+		std::memcpy(ptr, &freeLists[sizeIndex], sizeof(void *));
+		freeLists[sizeIndex] = ptr;
+	}
+
+	/// Total number of elements allocated
+	size_t allocations() const {
+		return allocCount;
+	}
+	/// Number of those which needed memory from the heap (one per block)
+	size_t heapAllocations() const {
+		return blockAllocCount;
+	}
+	size_t memoryBytes() const {
+		return totalBytes;
 	}
 };
 
@@ -524,19 +1841,90 @@ public:
 	Copy/assign is disabled, to prevent accidental copying when you should be holding a reference.
 */
 class SvgDrawable {
-	std::vector<std::unique_ptr<SvgDrawable>> children, layoutChildren;
+	// Declared before the children, so it outlives them
+	std::unique_ptr<DrawableArena> ownedArena;
+	DrawableArena *arenaPtr = nullptr;
+	// Where this element's memory came from, if it was made by `.create()` using an arena
+	DrawableArena *allocatedFrom = nullptr;
+	void *allocation = nullptr;
+	size_t allocationSize = 0;
+public:
+	/// Deletes an element, returning its memory to the arena if it came from one
+	struct Deleter {
+		void operator()(SvgDrawable *drawable) const {
+			DrawableArena *arena = drawable->allocatedFrom;
+			if (!arena) {
+				delete drawable;
+				return;
+			}
+			void *ptr = drawable->allocation;
+			size_t size = drawable->allocationSize;
+			drawable->~SvgDrawable();
+			arena->release(ptr, size);
+		}
+	};
+private:
+	std::vector<std::unique_ptr<SvgDrawable, Deleter>> children, layoutChildren;
 	bool hasLayout = false;
+	bool layoutDirty = true; // own layout (including layout children) needs rebuilding, not just the bounds
+	size_t layoutStyleKey = 0;
 protected:
 	Bounds bounds;
 	
 	void invalidateLayout() {
+		resetLayout(0);
+	}
+	/// Invalidates the layout of this element and everything inside it
+	virtual void resetLayout(size_t styleKey) {
 		hasLayout = bounds.set = false;
-		for (auto &c : children) c->invalidateLayout();
+		layoutDirty = true;
+		layoutStyleKey = styleKey;
+		for (auto &c : children) c->resetLayout(styleKey);
 		layoutChildren.resize(0);
 	}
+	/// Only the bounds need recalculating (e.g. because a child changed), keeping any layout children
+	void invalidateBounds() {
+		hasLayout = bounds.set = false;
+	}
+	/// Marks this element's own layout as changed, so the next write rebuilds it (and everything inside it)
+	void markLayoutDirty() {
+		layoutDirty = true;
+	}
+	/// Whether `.layout()` needs to rebuild this element's own layout, or only recalculate its bounds
+	bool isLayoutDirty() const {
+		return layoutDirty;
+	}
+	/// Checks for changes which aren't flagged by `.markLayoutDirty()`, such as to axes shared with other elements
+	virtual bool layoutChanged() {
+		return false;
+	}
+	/// Whether this element's layout depends on its parent's, so it should be rebuilt whenever the parent's bounds are recalculated
+	virtual bool layoutDependsOnParent() const {
+		return false;
+	}
+	/** Invalidates only what has changed since the last layout: dirty elements (and everything inside them), plus the bounds of anything containing them.
+		Returns whether this element needs to be laid out again. */
+	virtual bool refreshLayout(size_t styleKey) {
+		if (layoutDirty || styleKey != layoutStyleKey || layoutChanged()) {
+			resetLayout(styleKey);
+			return true;
+		}
+		bool changed = !hasLayout;
+		for (auto &c : children) {
+			if (c->refreshLayout(styleKey)) changed = true;
+		}
+		if (changed) {
+			invalidateBounds();
+			for (auto &c : children) {
+				if (c->layoutDependsOnParent()) c->resetLayout(styleKey);
+			}
+		}
+		return changed;
+	}
 	virtual void layout(const PlotStyle &style) {
 		hasLayout = true;
-		auto processChild = [&](std::unique_ptr<SvgDrawable> &child) {
+		layoutDirty = false;
+		auto processChild = [&](std::unique_ptr<SvgDrawable, Deleter> &child) {
 			child->layoutIfNeeded(style);
 			if (bounds.set) {
 				if (child->bounds.set) bounds.expandTo(child->bounds);
@@ -549,14 +1937,48 @@ protected:
 	};
 	/// These children are removed when the layout is invalidated
 	void addLayoutChild(SvgDrawable *child) {
+		adopt(child);
 		layoutChildren.emplace_back(child);
 	}
+	/// Allocates this element and everything added to it from an arena, which is then owned by this element
+	void useArena(size_t blockBytes=65536) {
+		ownedArena.reset(new DrawableArena(blockBytes));
+		arenaPtr = ownedArena.get();
+	}
+	/// Children share their parent's arena (if it has one)
+	void adopt(SvgDrawable *child) {
+		if (!child->arenaPtr) child->arenaPtr = arenaPtr;
+	}
 public:
 	SvgDrawable() {}
 	virtual ~SvgDrawable() {}
 	SvgDrawable(const SvgDrawable &other) = delete;
 	SvgDrawable & operator =(const SvgDrawable &other) = delete;
 
+	/// The arena used for new child elements, or `nullptr` for the heap
+	DrawableArena * arena() const {
+		return arenaPtr;
+	}
+	/** Creates an element using this element's arena (or the heap, if it doesn't have one), ready to pass to `.addChild()`.
+		Elements can also be created with plain `new`, which are then deleted normally. */
+	template<class T, class ...Args>
+	T * create(Args &&...args) {
+		if (!arenaPtr) return new T(std::forward<Args>(args)...);
+		void *ptr = arenaPtr->allocate(sizeof(T));
+		T *result;
+		try {
+			result = new (ptr) T(std::forward<Args>(args)...);
+		} catch (...) {
+			arenaPtr->release(ptr, sizeof(T));
+			throw;
+		}
+		SvgDrawable *drawable = result;
+		drawable->allocatedFrom = arenaPtr;
+		drawable->allocation = ptr;
+		drawable->allocationSize = sizeof(T);
+		return result;
+	}
+
 	Bounds layoutIfNeeded(const PlotStyle &style) {
 		if (!hasLayout) this->layout(style);
 		return bounds;
@@ -564,6 +1986,7 @@ public:
 
 	/// Takes ownership of the child
 	void addChild(SvgDrawable *child, bool front=false) {
+		adopt(child);
 		if (front) {
 			children.emplace(children.begin(), child);
 		} else {
@@ -607,33 +2030,24 @@ public:
 
 /// Top-level objects which can generate SVG files
 class SvgFileDrawable : public SvgDrawable {
-public:
-	void write(std::ostream &o, const PlotStyle &style) {
-		this->invalidateLayout();
-		this->layout(style);
-
-		// Add padding
-		auto bounds = this->bounds.pad(style.padding);
-		
-		int scale10 = 1;
-		while (style.scale > scale10*4) scale10 *= 10;
-		SvgWriter svg(o, bounds, style.precision*scale10);
-		svg.raw("<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"no\"?>\n<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n");
-		svg.tag("svg").attr("version", "1.1").attr("class", "svg-plot")
-			.attr("xmlns", "http://www.w3.org/2000/svg")
-			.attr("width", bounds.width()*style.scale, "pt").attr("height", bounds.height()*style.scale, "pt")
-			.attr("viewBox", bounds.left, " ", bounds.top, " ", bounds.width(), " ", bounds.height())
-			.attr("preserveAspectRatio", "xMidYMid");
-
-		svg.rect(bounds.left, bounds.top, bounds.width(), bounds.height())
-			.attr("class", "svg-plot-bg");
-		this->writeData(svg, style);
-		this->writeLabel(svg, style);
+	double layoutSeconds = 0;
 
-		int maxBounds = (int) std::ceil(std::max(
-			std::max(std::abs(this->bounds.left), std::abs(this->bounds.right)),
-			std::max(std::abs(this->bounds.top), std::abs(this->bounds.bottom))
-		)*std::sqrt(2));
+	enum {cachedDefs, cachedCss};
+	template<class WriteFn>
+	static void writeCached(SvgWriter &svg, const PlotStyle &style, int slot, long long key, WriteFn &&writeFn) {
+		if (svg.rawOutput().streamNumbers) return writeFn(svg); // custom number formatting, so don't use (or fill) the cache
+		auto text = style.cached(slot, key, [&]() {
+			SvgStringOutput output;
+			{
+				SvgWriter partSvg(output, svg);
+				writeFn(partSvg);
+			}
+			return output.str();
+		});
+		svg.raw(*text);
+	}
+	/// Markers and hatching patterns
+	static void writeDefs(SvgWriter &svg, const PlotStyle &style, int maxBounds) {
 		svg.raw("<defs>");
 		for (size_t i = 0; i < style.markers.size(); ++i) {
 			svg.tag("g").attr("id", style.markerId(int(i))).attr("class", "svg-plot-marker");
@@ -660,46 +2074,254 @@ public:
 			svg.raw("</pattern>");
 		}
 		svg.raw("</defs>");
-
-		// Strip whitespace that doesn't appear between letters/numbers
-		auto addCompactCss = [&](const std::string &css) {
-			const char *cPtr = css.c_str();
-			bool letter = false, letterThenWhitespace = false;
-			while (*cPtr) {
-				char c = *(cPtr++);
-				if (c == '\t' || c == '\n' || c == ' ') {
-					letterThenWhitespace = letter;
-				} else {
-					letter = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '.' || c == ')' || c == ']';
-					if (letterThenWhitespace && letter) o << ' ';
-					letterThenWhitespace = false;
-					o << c;
-				}
+	}
+	// Strip whitespace that doesn't appear between letters/numbers
+	static void writeCompactCss(SvgWriter &svg, const std::string &css) {
+		const char *cPtr = css.c_str();
+		bool letter = false, letterThenWhitespace = false;
+		while (*cPtr) {
+			char c = *(cPtr++);
+			if (c == '\t' || c == '\n' || c == ' ') {
+				letterThenWhitespace = letter;
+			} else {
+				letter = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '.' || c == ')' || c == ']';
+				if (letterThenWhitespace && letter) svg.raw(' ');
+				letterThenWhitespace = false;
+				svg.raw(c);
 			}
-		};
-
+		}
+	}
+	/// Compacted `<style>` blocks
+	static void writeCss(SvgWriter &svg, const PlotStyle &style) {
 		svg.raw("<style>");
 		std::stringstream cssStream;
 		style.css(cssStream);
-		addCompactCss(style.cssPrefix + cssStream.str());
+		writeCompactCss(svg, style.cssPrefix + cssStream.str());
 		svg.raw("</style>");
 		// Some things (like @import) can only happen at the start of CSS, so we support this by having two <style>s
 		if (style.cssSuffix.size()) {
 			svg.raw("<style>");
-			addCompactCss(style.cssSuffix);
+			writeCompactCss(svg, style.cssSuffix);
 			svg.raw("</style>");
 		}
+	}
+	static const char * xmlHeader() {
+		return "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"no\"?>\n<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n";
+	}
+public:
+	class SharedStyle;
+private:
+	void writeSvg(SvgOutput &output, const PlotStyle &style, SharedStyle *shared) {
+		auto layoutStart = std::chrono::steady_clock::now();
+		this->refreshLayout(style.layoutKey());
+		this->layoutIfNeeded(style);
+		layoutSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - layoutStart).count();
+
+		// Add padding
+		auto bounds = this->bounds.pad(style.padding);
+		
+		int scale10 = 1;
+		while (style.scale > scale10*4) scale10 *= 10;
+		SvgWriter svg(output, bounds, style.precision*scale10);
+		svg.simplify = style.simplify;
+		svg.pathEncoding = style.pathEncoding;
+		svg.simplifyError = (style.simplifyError > 0) ? style.simplifyError : 1/(style.precision*scale10);
+		svg.raw(xmlHeader());
+		if (shared) {
+			svg.raw("<?xml-stylesheet type=\"text/css\"").attr("href", shared->cssHref).raw("?>\n");
+			svg.defsHref = shared->defsHref;
+		}
+		svg.tag("svg").attr("version", "1.1").attr("class", "svg-plot")
+			.attr("xmlns", "http://www.w3.org/2000/svg")
+			.attr("width", bounds.width()*style.scale, "pt").attr("height", bounds.height()*style.scale, "pt")
+			.attr("viewBox", bounds.left, " ", bounds.top, " ", bounds.width(), " ", bounds.height())
+			.attr("preserveAspectRatio", "xMidYMid");
+
+		svg.rect(bounds.left, bounds.top, bounds.width(), bounds.height())
+			.attr("class", "svg-plot-bg");
+		this->writeData(svg, style);
+		this->writeLabel(svg, style);
+
+		int maxBounds = (int) std::ceil(std::max(
+			std::max(std::abs(this->bounds.left), std::abs(this->bounds.right)),
+			std::max(std::abs(this->bounds.top), std::abs(this->bounds.bottom))
+		)*std::sqrt(2));
+		if (shared) {
+			shared->includeBounds(maxBounds);
+		} else {
+			// These are the same for every plot with the same style (and similar size), so they're cached
+			writeCached(svg, style, cachedDefs, maxBounds, [&](SvgWriter &svg) {
+				writeDefs(svg, style, maxBounds);
+			});
+			writeCached(svg, style, cachedCss, 0, [&](SvgWriter &svg) {
+				writeCss(svg, style);
+			});
+		}
+		if (style.scriptAnimation) {
+			svg.raw("<script>").raw(PlotStyle::scriptAnimationPlayer()).raw("</script>");
+		}
 		if (style.scriptSrc.size() > 0) {
 			svg.raw("<script>").write(style.scriptSrc).raw("</script>");
 		}
 		if (style.scriptHref.size()) svg.tag("script", true).attr("href", style.scriptHref);
 		svg.raw("</svg>");
 	}
+public:
+	/// Statistics from the most recent `.write()`
+	struct WriteStats {
+		size_t bytes = 0; ///< SVG size (uncompressed)
+		size_t compressedBytes = 0; ///< file size, when writing `.svgz`
+		double seconds = 0, compressSeconds = 0;
+		double layoutSeconds = 0; ///< time spent on layout, which is only redone for parts which have changed since the previous write
+		size_t allocations = 0; ///< elements created during the write (by layout), if using an arena (e.g. in a `Figure`)
+		size_t heapAllocations = 0; ///< how many arena blocks those needed from the heap
+		
+		double compressionRatio() const {
+			return compressedBytes ? double(bytes)/compressedBytes : 1;
+		}
+	};
+	WriteStats lastWrite;
+
+	/** CSS and `<defs>` in separate files, shared by multiple SVGs instead of being included in each one.  This makes a large batch of small plots much smaller.
+		\code
+			SvgFileDrawable::SharedStyle shared("plot-style.css", "plot-defs.svg");
+			figureA.write("a.svg", shared);
+			figureB.write("b.svg", shared);
+			if (!shared.writeFiles()) {
+				// handle the error
+			}
+		\endcode
+		If there are unwritten changes when it goes out of scope, it attempts to write them, but any errors there are ignored.
+		All SVGs are written using `.style`, not their own (e.g. `Figure::style`).
+
+		The shared files are referenced using `.cssHref`/`.defsHref`, which default to the file names, and the CSS refers to the defs file by name, so they should be in the same directory.  Browsers only load these from the same origin, and not at all for SVGs used as an `<img>`, so the default (inline) output is more portable.
+	*/
+	class SharedStyle {
+		std::string cssFile, defsFile;
+		std::atomic<int> maxBounds{0};
+		std::atomic<bool> pending{false};
+
+		// Relative to the CSS, which we assume is next to the defs file
+		std::string defsFromCss() const {
+			size_t slash = defsHref.rfind('/');
+			return (slash == std::string::npos) ? defsHref : defsHref.substr(slash + 1);
+		}
+	public:
+		PlotStyle style;
+		std::string cssHref, defsHref;
+
+		SharedStyle(const std::string &cssFile, const std::string &defsFile, const PlotStyle &style=PlotStyle::defaultStyle()) : cssFile(cssFile), defsFile(defsFile), style(style), cssHref(cssFile), defsHref(defsFile) {}
+		~SharedStyle() noexcept {
+			if (!pending) return;
+			try {
+				writeFiles();
+			} catch (...) {}
+		}
+		SharedStyle(const SharedStyle &other) = delete;
+		SharedStyle & operator=(const SharedStyle &other) = delete;
+
+		/// Hatching masks in the defs need to cover every SVG using them
+		void includeBounds(int bounds) {
+			int current = maxBounds;
+			while (bounds > current && !maxBounds.compare_exchange_weak(current, bounds)) {}
+			pending = true;
+		}
+
+		void writeCss(std::ostream &o) const {
+			SvgWriter svg(o, {}, style.precision);
+			std::stringstream cssStream;
+			style.css(cssStream, defsFromCss());
+			writeCompactCss(svg, style.cssPrefix + cssStream.str() + "\n" + style.cssSuffix);
+		}
+		/// An SVG file containing only `<defs>` (and the CSS they need)
+		void writeDefs(std::ostream &o) const {
+			SvgWriter svg(o, {}, style.precision);
+			svg.raw(xmlHeader());
+			svg.tag("svg").attr("version", "1.1").attr("class", "svg-plot").attr("xmlns", "http://www.w3.org/2000/svg");
+			SvgFileDrawable::writeCss(svg, style);
+			SvgFileDrawable::writeDefs(svg, style, maxBounds);
+			svg.raw("</svg>");
+		}
+		/// Writes (or updates) the CSS and defs files, returning `false` if either of them failed
+		bool writeFiles() {
+			pending = false;
+			std::ofstream cssStream(cssFile);
+			writeCss(cssStream);
+			cssStream.close();
+			std::ofstream defsStream(defsFile);
+			writeDefs(defsStream);
+			defsStream.close();
+			if (cssStream.fail() || defsStream.fail()) {
+				pending = true;
+				return false;
+			}
+			return true;
+		}
+	};
+
+	void write(SvgOutput &output, const PlotStyle &style) {
+		writeOutput(output, style, nullptr);
+	}
+	/// Writes an SVG which references the shared CSS and `<defs>` instead of including them
+	void write(SvgOutput &output, SharedStyle &shared) {
+		writeOutput(output, shared.style, &shared);
+	}
+	void write(std::ostream &o, SharedStyle &shared) {
+		SvgOutput output(o);
+		write(output, shared);
+		output.flush();
+	}
+	void write(const std::string &svgFile, SharedStyle &shared) {
+		writeFile(svgFile, shared.style, &shared);
+	}
+private:
+	void writeOutput(SvgOutput &output, const PlotStyle &style, SharedStyle *shared) {
+		auto startTime = std::chrono::steady_clock::now();
+		size_t startBytes = output.bytes();
+		DrawableArena *arena = this->arena();
+		size_t startAllocations = arena ? arena->allocations() : 0, startHeapAllocations = arena ? arena->heapAllocations() : 0;
+		writeSvg(output, style, shared);
+		lastWrite = WriteStats();
+		lastWrite.bytes = output.bytes() - startBytes;
+		if (arena) {
+			lastWrite.allocations = arena->allocations() - startAllocations;
+			lastWrite.heapAllocations = arena->heapAllocations() - startHeapAllocations;
+		}
+		lastWrite.layoutSeconds = layoutSeconds;
+		lastWrite.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	}
+	void writeFile(const std::string &svgFile, const PlotStyle &style, SharedStyle *shared) {
+		size_t length = svgFile.size();
+		if (length >= 5 && svgFile.compare(length - 5, 5, ".svgz") == 0) {
+			auto startTime = std::chrono::steady_clock::now();
+			std::ofstream s(svgFile, std::ios::binary);
+			GzipOutput output(s, style.compressionLevel);
+			writeOutput(output, style, shared);
+			output.finish();
+			lastWrite.compressedBytes = output.outputBytes();
+			lastWrite.compressSeconds = output.compressSeconds();
+			lastWrite.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		} else {
+			std::ofstream s(svgFile);
+			SvgOutput output(s);
+			writeOutput(output, style, shared);
+			output.flush();
+		}
+	}
+public:
+	void write(std::ostream &o, const PlotStyle &style) {
+		SvgOutput output(o);
+		write(output, style);
+		output.flush();
+	}
+	/// Writes to a file, which is gzip-compressed if the name ends in `.svgz`
 	void write(const std::string &svgFile, const PlotStyle &style) {
-		std::ofstream s(svgFile);
-		write(s, style);
+		writeFile(svgFile, style, nullptr);
 	}
 	// If we aren't given a style, use the default one
+	void write(SvgOutput &output) {
+		this->write(output, PlotStyle::defaultStyle());
+	}
 	void write(std::ostream &o) {
 		this->write(o, PlotStyle::defaultStyle());
 	}
@@ -759,10 +2381,61 @@ struct Tick {
 	\endcode
 */
 class Axis {
-	std::function<double(double)> unitMap;
+	/// Maps values to the unit range as `(shape(v) - offset)*scale`, where `shape()` is identified by type, so common cases don't need a `std::function`
+	struct UnitMap {
+		enum class Type {linear, log, power, cbrt, custom};
+		Type type = Type::linear;
+		double offset = 0, scale = 1;
+		double exponent = 1; // for `power`
+		std::function<double(double)> custom;
+
+		double shape(double v) const {
+			switch (type) {
+				case Type::linear: return v;
+				case Type::log: return std::log(v);
+				case Type::power: return std::pow(v, exponent);
+				case Type::cbrt: return std::cbrt(v); // unlike `pow(v, 1/3)`, this is defined for negative values
+				default: return custom(v);
+			}
+		}
+		void setRange(double low, double high) {
+			offset = shape(low);
+			scale = 1/(shape(high) - offset);
+		}
+		// Recognises standard-library functions which we can calculate directly
+		static UnitMap fromFunction(double map(double)) {
+			UnitMap result{};
+			double (*logFn)(double) = std::log, (*log2Fn)(double) = std::log2, (*log10Fn)(double) = std::log10;
+			double (*sqrtFn)(double) = std::sqrt, (*cbrtFn)(double) = std::cbrt;
+			if (map == logFn) {
+				result.type = Type::log;
+			} else if (map == log2Fn || map == log10Fn) {
+				result.type = Type::log; // the same as `log` apart from a scale factor
+				result.scale = (map == log2Fn) ? 1/std::log(2.0) : 1/std::log(10.0);
+			} else if (map == sqrtFn) {
+				result.type = Type::power;
+				result.exponent = 0.5;
+			} else if (map == cbrtFn) {
+				result.type = Type::cbrt;
+			} else {
+				result.type = Type::custom;
+				result.custom = map;
+			}
+			return result;
+		}
+	};
+	UnitMap unitMap;
+	void setUnitMap(UnitMap newMap) {
+		++changeCounter;
+		autoScale = false;
+		for (auto other : linked) other->setUnitMap(newMap);
+		unitMap = std::move(newMap);
+	}
 	double autoMin, autoMax;
 	bool hasAutoValue = false;
 	bool autoScale, autoLabel;
+	bool autoScaled = false, autoLabelled = false; // whether the current range/ticks came from `.autoSetup()`
+	size_t changeCounter = 0;
 	std::string _label = "";
 
 	std::vector<Axis *> linked;
@@ -792,6 +2465,48 @@ public:
 	/// Not associated with a particular line by default, but can be
 	PlotStyle::Counter styleIndex = -1;
 
+	/// Incremented by anything which changes the axis' range, ticks or labels, so plots know when to re-do their layout
+	size_t version() const {
+		return changeCounter;
+	}
+	/// Everything a layout based on this axis depends on, including things which can be changed directly (`.styleIndex`, `.tickList`)
+	struct LayoutState {
+		size_t version = 0, ticksHash = 0;
+		PlotStyle::Counter styleIndex;
+		bool flipped = false;
+		double drawLow = 0, drawHigh = 0;
+
+		bool operator==(const LayoutState &other) const {
+			return version == other.version && ticksHash == other.ticksHash && styleIndex == other.styleIndex
+				&& flipped == other.flipped && drawLow == other.drawLow && drawHigh == other.drawHigh;
+		}
+		bool operator!=(const LayoutState &other) const {
+			return !(*this == other);
+		}
+	};
+	LayoutState layoutState() const {
+		LayoutState state;
+		state.version = changeCounter;
+		uint64_t hash = 14695981039346656037ull; // FNV-1a
+		auto addByte = [&](unsigned char byte) {
+			hash = (hash ^ byte)*1099511628211ull;
+		};
+		for (auto &t : tickList) {
+			uint64_t bits;
+			std::memcpy(&bits, &t.value, sizeof(bits));
+			for (int b = 0; b < 64; b += 8) addByte((bits >> b)&255);
+			addByte((unsigned char)t.strength);
+			for (char c : t.name) addByte((unsigned char)c);
+			addByte(0);
+		}
+		state.ticksHash = size_t(hash);
+		state.styleIndex = styleIndex;
+		state.flipped = flipped;
+		state.drawLow = drawLow;
+		state.drawHigh = drawHigh;
+		return state;
+	}
+
 	Axis(double drawLow, double drawHigh) : drawLow(drawLow), drawHigh(drawHigh) {
 		linear(0, 1);
 		autoScale = true;
@@ -803,6 +2518,75 @@ public:
 		removeLinkedParent();
 	}
 
+	/// Running min/max for a source of values, which the axis collects lazily (during `.autoSetup()`) instead of each value being registered individually
+	struct AutoRange {
+		double min = INFINITY, max = -INFINITY;
+
+		bool empty() const {
+			return !(min <= max);
+		}
+		/// NaNs are ignored
+		void add(double v) {
+			min = (v < min) ? v : min;
+			max = (v > max) ? v : max;
+		}
+		/// Branch-free reduction over an array, which the compiler can vectorise
+		template<class V>
+		void add(const V *values, size_t count, size_t stride=1) {
+			double lo = min, hi = max;
+			if (stride == 1) {
+				// Independent accumulators, so the compiler can use SIMD min/max (which have the same NaN behaviour as these comparisons)
+				double lo4[4] = {lo, lo, lo, lo}, hi4[4] = {hi, hi, hi, hi};
+				size_t blockEnd = count - count%4;
+				for (size_t i = 0; i < blockEnd; i += 4) {
+					for (size_t j = 0; j < 4; ++j) {
+						double v = values[i + j];
+						lo4[j] = (v < lo4[j]) ? v : lo4[j];
+						hi4[j] = (v > hi4[j]) ? v : hi4[j];
+					}
+				}
+				for (size_t j = 0; j < 4; ++j) {
+					lo = (lo4[j] < lo) ? lo4[j] : lo;
+					hi = (hi4[j] > hi) ? hi4[j] : hi;
+				}
+				for (size_t i = blockEnd; i < count; ++i) {
+					double v = values[i];
+					lo = (v < lo) ? v : lo;
+					hi = (v > hi) ? v : hi;
+				}
+			} else {
+				for (size_t i = 0; i < count; ++i) {
+					double v = values[i*stride];
+					lo = (v < lo) ? v : lo;
+					hi = (v > hi) ? v : hi;
+				}
+			}
+			min = lo;
+			max = hi;
+		}
+	};
+private:
+	std::vector<std::shared_ptr<const AutoRange>> autoRanges;
+	void collectAutoRangeTree() {
+		for (auto &range : autoRanges) {
+			if (range->empty()) continue;
+			autoValue(range->min);
+			autoValue(range->max);
+		}
+		for (auto child : linked) child->collectAutoRangeTree();
+	}
+public:
+	/// Registers a range to be included in the auto-scale when the plot is laid out.  The axis shares ownership, so values from a line which is destroyed (e.g. in another plot using this axis) still count, as if they had been added directly.
+	void autoRange(std::shared_ptr<const AutoRange> range) {
+		autoRanges.push_back(std::move(range));
+	}
+	/// Applies all registered `AutoRange`s (from this axis and any linked ones) via `.autoValue()`
+	void collectAutoRanges() {
+		Axis *root = this;
+		while (root->linkedParent) root = root->linkedParent;
+		root->collectAutoRangeTree();
+	}
+
 	/// Register a value for the auto-scale
 	void autoValue(double v) {
 		if (linkedParent) return linkedParent->autoValue(v);
@@ -823,14 +2607,36 @@ public:
 		}
 	}
 	void autoSetup() {
+		collectAutoRanges();
 		if (hasAutoValue) {
-			if (autoScale) linear(autoMin, autoMax);
-			if (autoLabel) minors(autoMin, autoMax);
+			if (autoScale) {
+				linear(autoMin, autoMax);
+				autoScaled = true;
+			}
+			if (autoLabel) {
+				minors(autoMin, autoMax);
+				autoLabelled = true;
+			}
 		}
 		for (auto other : linked) other->autoSetup();
 	}
+	/** Re-enables the auto-scale and auto-labelling (if they were used) for the next layout, e.g. before re-writing a plot whose data has changed.
+		The previous range and automatic ticks are discarded, as are values passed directly to `.autoValue()` (including line labels). */
+	Axis & autoRescale() {
+		++changeCounter;
+		if (autoScaled) autoScale = true;
+		if (autoLabelled) {
+			tickList.clear();
+			autoLabel = true;
+			for (auto other : linked) other->tickList.clear(); // they were copied from here
+		}
+		autoScaled = autoLabelled = hasAutoValue = false;
+		for (auto other : linked) other->autoRescale();
+		return *this;
+	}
 	/// Prevent auto-labelling
 	Axis & blank(bool includeLinked=false) {
+		++changeCounter;
 		tickList.clear();
 		autoLabel = false;
 		if (includeLinked) {
@@ -840,6 +2646,7 @@ public:
 	}
 	/// Clear the names from any existing labels
 	Axis & blankLabels(bool includeLinked=false) {
+		++changeCounter;
 		for (auto &t : tickList) t.name = "";
 		_label = "";
 		if (includeLinked) {
@@ -849,6 +2656,8 @@ public:
 	}
 	/// Copy ticks/label from another axis, optionally removing their text
 	Axis & copyFrom(Axis &other, bool clearLabels=false) {
+		++changeCounter;
+		other.collectAutoRanges();
 		unitMap = other.unitMap;
 		for (Tick tick : other.tickList) {
 			if (clearLabels) tick.name = "";
@@ -879,6 +2688,7 @@ public:
 	/// Whether the axis should draw on the non-default side (e.g. right/top)
 	bool flipped = false;
 	Axis & flip(bool flip=true) {
+		++changeCounter;
 		flipped = flip;
 		for (auto other : linked) other->flip(flip);
 		return *this;
@@ -886,6 +2696,7 @@ public:
 	
 	/// Sets the label, and optionally style to match a particular line.
 	Axis & label(std::string l, PlotStyle::Counter index=-1) {
+		++changeCounter;
 		_label = l;
 		styleIndex = index;
 		for (auto other : linked) other->label(l, index);
@@ -895,40 +2706,78 @@ public:
 		return _label;
 	}
 
+	/// Custom map from values to the unit range (0-1)
 	Axis & range(std::function<double(double)> valueToUnit) {
-		autoScale = false;
-		unitMap = valueToUnit;
-		for (auto other : linked) other->range(valueToUnit);
+		UnitMap newMap{};
+		newMap.type = UnitMap::Type::custom;
+		newMap.custom = valueToUnit;
+		setUnitMap(newMap);
 		return *this;
 	}
 	Axis & range(double map(double)) {
-		return range(std::function<double(double)>(map));
+		setUnitMap(UnitMap::fromFunction(map));
+		return *this;
 	}
+	/// Maps values to the unit range using `map()`, so that `lowValue` maps to 0 and `highValue` to 1
 	Axis & range(std::function<double(double)> map, double lowValue, double highValue) {
-		double lowMapped = map(lowValue), highMapped = map(highValue);
-		return range([=](double v) {
-			double mapped = map(v);
-			return (mapped - lowMapped)/(highMapped - lowMapped);
-		});
+		UnitMap newMap{};
+		newMap.type = UnitMap::Type::custom;
+		newMap.custom = map;
+		newMap.setRange(lowValue, highValue);
+		setUnitMap(newMap);
+		return *this;
 	}
+	/// Recognises `std::log`/`std::log2`/`std::log10`/`std::sqrt`/`std::cbrt`, and calculates them without a `std::function`
 	Axis & range(double map(double), double lowValue, double highValue) {
-		return range(std::function<double(double)>(map), lowValue, highValue);
+		UnitMap newMap = UnitMap::fromFunction(map);
+		newMap.setRange(lowValue, highValue);
+		setUnitMap(newMap);
+		return *this;
 	}
 	Axis & linear(double low, double high) {
-		return range([=](double v) {
-			return (v - low)/(high - low);
-		});
+		UnitMap newMap{};
+		newMap.setRange(low, high);
+		setUnitMap(newMap);
+		return *this;
+	}
+	/// Power-law scale (`v^exponent`), mapping `low`/`high` to the edges
+	Axis & power(double exponent, double low, double high) {
+		UnitMap newMap{};
+		newMap.type = UnitMap::Type::power;
+		newMap.exponent = exponent;
+		newMap.setRange(low, high);
+		setUnitMap(newMap);
+		return *this;
 	}
 	
-	double map(double v) {
-		double unit = unitMap(v);
-		return drawLow + unit*(drawHigh - drawLow);
+	double map(double v) const {
+		// Fold the unit map and draw range into a single multiply-add
+		double a = unitMap.scale*(drawHigh - drawLow), b = drawLow - unitMap.offset*a;
+		return unitMap.shape(v)*a + b;
+	}
+	/// Maps an array of values (which can be in-place).  Apart from custom maps, these are simple loops the compiler can vectorise.
+	template<class V>
+	void map(const V *values, double *output, size_t count) const {
+		const double a = unitMap.scale*(drawHigh - drawLow), b = drawLow - unitMap.offset*a;
+		if (unitMap.type == UnitMap::Type::linear) {
+			for (size_t i = 0; i < count; ++i) output[i] = double(values[i])*a + b;
+		} else if (unitMap.type == UnitMap::Type::log) {
+			for (size_t i = 0; i < count; ++i) output[i] = std::log(double(values[i]))*a + b;
+		} else if (unitMap.type == UnitMap::Type::power) {
+			const double exponent = unitMap.exponent;
+			for (size_t i = 0; i < count; ++i) output[i] = std::pow(double(values[i]), exponent)*a + b;
+		} else if (unitMap.type == UnitMap::Type::cbrt) {
+			for (size_t i = 0; i < count; ++i) output[i] = std::cbrt(double(values[i]))*a + b;
+		} else {
+			for (size_t i = 0; i < count; ++i) output[i] = unitMap.custom(values[i])*a + b;
+		}
 	}
 
 	std::vector<Tick> tickList;
 
 	template<class ...Args>
 	Axis & major(Args &&...args) {
+		++changeCounter;
 		Tick t(args...);
 		autoValue(t.value);
 		t.strength = Tick::Strength::major;
@@ -939,6 +2788,7 @@ public:
 	}
 	template<class ...Args>
 	Axis & minor(Args &&...args) {
+		++changeCounter;
 		Tick t(args...);
 		autoValue(t.value);
 		t.strength = Tick::Strength::minor;
@@ -949,6 +2799,7 @@ public:
 	}
 	template<class ...Args>
 	Axis & tick(Args &&...args) {
+		++changeCounter;
 		Tick t(args...);
 		autoValue(t.value);
 		t.strength = Tick::Strength::tick;
@@ -966,6 +2817,7 @@ public:
 		return major(tick).majors(args...);
 	}
 	Axis &minors() {
+		++changeCounter;
 		autoLabel = false;
 		return *this;
 	}
@@ -974,6 +2826,7 @@ public:
 		return minor(tick).minors(args...);
 	}
 	Axis & ticks() {
+		++changeCounter;
 		autoLabel = false;
 		return *this;
 	}
@@ -1054,11 +2907,370 @@ class Line2D : public SvgDrawable {
 	Line2D *fillToLine = nullptr;
 	
 	Axis &axisX, &axisY;
-	struct LinePoint : public Point2D {
-		bool isMove;
-		LinePoint(double x, double y, bool isMove) : Point2D({x, y}), isMove(isMove) {}
+	// Running ranges, which the axes collect at layout time (instead of every point calling `.autoValue()`)
+	std::shared_ptr<Axis::AutoRange> autoX = std::make_shared<Axis::AutoRange>(), autoY = std::make_shared<Axis::AutoRange>();
+	/// Column of values, stored as either `double` or (to save memory) `float`, or a non-owning view of external data
+	struct LineColumn {
+		bool useFloat = false;
+		std::vector<double> doubles;
+		std::vector<float> floats;
+		// Borrowed data (see `Line2D::borrow()`)
+		const double *viewDoubles = nullptr;
+		const float *viewFloats = nullptr;
+		size_t viewSize = 0, viewStride = 1;
+
+		bool isView() const {
+			return viewDoubles || viewFloats;
+		}
+		size_t size() const {
+			if (isView()) return viewSize;
+			return useFloat ? floats.size() : doubles.size();
+		}
+		double operator[](size_t i) const {
+			if (viewDoubles) return viewDoubles[i*viewStride];
+			if (viewFloats) return viewFloats[i*viewStride];
+			return useFloat ? floats[i] : doubles[i];
+		}
+		void push_back(double v) {
+			copyView();
+			if (useFloat) {
+				floats.push_back(float(v));
+			} else {
+				doubles.push_back(v);
+			}
+		}
+		/// Converts and appends values from any indexable source
+		template<class Array>
+		void append(Array &&array, size_t count) {
+			copyView();
+			if (useFloat) {
+				appendTo(floats, array, count);
+			} else {
+				appendTo(doubles, array, count);
+			}
+		}
+		/// Appends another column's values, copying directly if the storage types match
+		void appendColumn(const LineColumn &other) {
+			copyView();
+			if (other.isView() || other.useFloat != useFloat) return append(other, other.size());
+			if (useFloat) {
+				floats.insert(floats.end(), other.floats.begin(), other.floats.end());
+			} else {
+				doubles.insert(doubles.end(), other.doubles.begin(), other.doubles.end());
+			}
+		}
+		void view(const double *data, size_t size, size_t stride) {
+			clear();
+			viewDoubles = data;
+			viewSize = size;
+			viewStride = stride;
+		}
+		void view(const float *data, size_t size, size_t stride) {
+			clear();
+			viewFloats = data;
+			viewSize = size;
+			viewStride = stride;
+		}
+		size_t capacity() const {
+			return useFloat ? floats.capacity() : doubles.capacity();
+		}
+		void reserve(size_t size) {
+			if (useFloat) {
+				floats.reserve(size);
+			} else {
+				doubles.reserve(size);
+			}
+		}
+		void setFloat(bool f) {
+			if (f == useFloat) return;
+			if (f) {
+				floats.assign(doubles.begin(), doubles.end());
+				doubles = std::vector<double>();
+			} else {
+				doubles.assign(floats.begin(), floats.end());
+				floats = std::vector<float>();
+			}
+			useFloat = f;
+		}
+		void clear() {
+			doubles.clear();
+			floats.clear();
+			viewDoubles = nullptr;
+			viewFloats = nullptr;
+			viewSize = 0;
+		}
+		void map(const Axis &axis, size_t start, double *output, size_t length) const {
+			if (isView()) {
+				if (viewStride == 1) {
+					if (viewDoubles) return axis.map(viewDoubles + start, output, length);
+					return axis.map(viewFloats + start, output, length);
+				}
+				for (size_t i = 0; i < length; ++i) output[i] = (*this)[start + i];
+				return axis.map(output, output, length);
+			}
+			if (useFloat) {
+				axis.map(floats.data() + start, output, length);
+			} else {
+				axis.map(doubles.data() + start, output, length);
+			}
+		}
+		/// Adds values from `start` onwards to a range, in a single pass over the underlying data
+		void addRange(Axis::AutoRange &range, size_t start=0) const {
+			if (start >= size()) return;
+			size_t count = size() - start;
+			if (viewDoubles) return range.add(viewDoubles + start*viewStride, count, viewStride);
+			if (viewFloats) return range.add(viewFloats + start*viewStride, count, viewStride);
+			if (useFloat) return range.add(floats.data() + start, count);
+			range.add(doubles.data() + start, count);
+		}
+		size_t memoryBytes() const {
+			return doubles.capacity()*sizeof(double) + floats.capacity()*sizeof(float);
+		}
+	private:
+		// Before modifying a view, we take a copy
+		void copyView() {
+			if (!isView()) return;
+			size_t size = viewSize;
+			std::vector<double> copy(size);
+			for (size_t i = 0; i < size; ++i) copy[i] = (*this)[i];
+			clear();
+			append(copy, size);
+		}
+		template<class T, class Array>
+		static void appendTo(std::vector<T> &vector, Array &&array, size_t count) {
+			size_t start = vector.size();
+			vector.resize(start + count);
+			T *data = vector.data() + start;
+			for (size_t i = 0; i < count; ++i) data[i] = T(array[i]);
+		}
+	};
+	/// Points stored as separate x/y columns, with the (sparse) indices where each sub-path starts
+	struct LinePoints {
+		LineColumn x, y;
+		std::vector<size_t> moves;
+
+		size_t size() const {
+			return x.size();
+		}
+		void add(double px, double py, bool isMove) {
+			if (isMove || !x.size()) moves.push_back(x.size());
+			x.push_back(px);
+			y.push_back(py);
+		}
+		void clear() {
+			x.clear();
+			y.clear();
+			moves.clear();
+		}
+		/// Appends all of another set of points, keeping its sub-paths separate
+		void append(const LinePoints &other) {
+			size_t offset = size();
+			for (auto m : other.moves) moves.push_back(m + offset);
+			x.appendColumn(other.x);
+			y.appendColumn(other.y);
+		}
+		/// Index one past the end of sub-path `s`
+		size_t moveEnd(size_t s) const {
+			return (s + 1 < moves.size()) ? moves[s + 1] : x.size();
+		}
+		size_t memoryBytes() const {
+			return x.memoryBytes() + y.memoryBytes() + moves.capacity()*sizeof(size_t);
+		}
+	};
+	LinePoints points;
+	/// Lazily-built ordering of the x-values, for nearest-point lookups.  Appending points only needs `.update()`, but anything else which changes the values must `.reset()`.
+	struct XOrder {
+		// Prefix which has been checked for being non-decreasing
+		size_t checked = 0;
+		bool ascending = true;
+		// Indices of the non-NaN points sorted by (x, index), only built if x isn't ascending
+		std::vector<size_t> sorted;
+		size_t sortedSize = 0;
+
+		void reset() {
+			checked = sortedSize = 0;
+			ascending = true;
+			sorted.clear();
+		}
+		void update(const LinePoints &points) {
+			size_t size = points.size();
+			if (ascending) {
+				if (!checked && size && std::isnan(points.x[0])) ascending = false;
+				for (size_t i = std::max<size_t>(checked, 1); ascending && i < size; ++i) {
+					if (!(points.x[i] >= points.x[i - 1])) ascending = false;
+				}
+				checked = size;
+				if (ascending) return;
+			}
+			if (sortedSize == size) return;
+			sorted.clear();
+			for (size_t i = 0; i < size; ++i) {
+				if (!std::isnan(points.x[i])) sorted.push_back(i);
+			}
+			std::stable_sort(sorted.begin(), sorted.end(), [&](size_t a, size_t b) {
+				return points.x[a] < points.x[b];
+			});
+			sortedSize = size;
+		}
+		size_t count(const LinePoints &points) const {
+			return ascending ? points.size() : sorted.size();
+		}
+		size_t indexAt(size_t k) const {
+			return ascending ? k : sorted[k];
+		}
+		/// First position (in sorted order) whose x-value is not less than `x`
+		size_t lowerBound(const LinePoints &points, double x) const {
+			size_t low = 0, high = count(points);
+			while (low < high) {
+				size_t mid = low + (high - low)/2;
+				if (points.x[indexAt(mid)] < x) {
+					low = mid + 1;
+				} else {
+					high = mid;
+				}
+			}
+			return low;
+		}
+
+		/// Index of the point closest in x (the earliest one, if there's a tie), or `points.size()` if there are none
+		size_t nearestX(const LinePoints &points, double x) {
+			update(points);
+			size_t best = points.size();
+			double bestError = 0;
+			// Only the first of a run of equal x-values needs checking, since it has the lowest index
+			auto consider = [&](size_t k) {
+				size_t i = indexAt(k);
+				double error = std::abs(points.x[i] - x);
+				if (best == points.size() || error < bestError || (error == bestError && i < best)) {
+					best = i;
+					bestError = error;
+				}
+			};
+			size_t k = lowerBound(points, x);
+			if (k < count(points)) consider(k);
+			if (k > 0) consider(lowerBound(points, points.x[indexAt(k - 1)]));
+			return best;
+		}
+
+		/// Index of the point closest to (x, y), with distances in each direction multiplied by a scale factor
+		size_t nearest(const LinePoints &points, double x, double y, double scaleX, double scaleY) {
+			update(points);
+			size_t best = points.size(), n = count(points);
+			double bestDist2 = INFINITY;
+			auto consider = [&](size_t k) {
+				size_t i = indexAt(k);
+				double dx = (points.x[i] - x)*scaleX, dy = (points.y[i] - y)*scaleY;
+				double dist2 = dx*dx + dy*dy;
+				if (dist2 < bestDist2 || (dist2 == bestDist2 && i < best)) {
+					best = i;
+					bestDist2 = dist2;
+				}
+			};
+			auto xDist2 = [&](size_t k) {
+				double dx = (points.x[indexAt(k)] - x)*scaleX;
+				return dx*dx;
+			};
+			// Search outwards in x, stopping once the x-distance alone is too far
+			size_t start = lowerBound(points, x);
+			for (size_t k = start; k < n && xDist2(k) <= bestDist2; ++k) consider(k);
+			for (size_t k = start; k > 0 && xDist2(k - 1) <= bestDist2; --k) consider(k - 1);
+			return best;
+		}
+	};
+	XOrder xOrder;
+	/// Monotonic deque of (index, value) for the min or max of a sliding window, so old values can drop out without a rescan
+	template<bool isMax>
+	struct WindowExtreme {
+		struct Entry {
+			size_t index;
+			double value;
+		};
+		std::vector<Entry> ring; // at most one entry per value in the window, so this never grows
+		size_t head = 0, count = 0;
+
+		void reset(size_t capacity) {
+			ring.assign(capacity, Entry{0, 0});
+			head = count = 0;
+		}
+		/// Adds a value (NaNs are ignored), dropping any entries from before `windowStart`
+		void push(size_t index, double value, size_t windowStart) {
+			while (count && ring[head].index < windowStart) {
+				if (++head == ring.size()) head = 0;
+				--count;
+			}
+			if (std::isnan(value)) return;
+			// Anything which the new value beats can never be the extreme again
+			while (count) {
+				double back = ring[wrap(head + count - 1)].value;
+				if (isMax ? (back > value) : (back < value)) break;
+				--count;
+			}
+			ring[wrap(head + count)] = {index, value};
+			++count;
+		}
+		size_t wrap(size_t i) const {
+			return (i >= ring.size()) ? i - ring.size() : i;
+		}
+		bool empty() const {
+			return !count;
+		}
+		double front() const {
+			return ring[head].value;
+		}
+	};
+	/** Fixed-capacity window of the latest points (see `.rolling()`).
+		Each value is written twice (at `i` and `i + capacity`), so the window is always a contiguous view, which renders like any other points. */
+	struct RollingPoints {
+		size_t capacity = 0, count = 0, next = 0;
+		size_t pushed = 0; // total, used as the index for the min/max deques
+		std::vector<double> x, y;
+		WindowExtreme<false> minX, minY;
+		WindowExtreme<true> maxX, maxY;
+		std::shared_ptr<Axis::AutoRange> rangeX = std::make_shared<Axis::AutoRange>(), rangeY = std::make_shared<Axis::AutoRange>();
+		bool registered = false;
+
+		void reset(size_t newCapacity) {
+			capacity = newCapacity;
+			x.assign(capacity*2, 0);
+			y.assign(capacity*2, 0);
+			minX.reset(capacity);
+			minY.reset(capacity);
+			maxX.reset(capacity);
+			maxY.reset(capacity);
+			clear();
+		}
+		void clear() {
+			count = next = 0;
+			minX.head = minX.count = minY.head = minY.count = 0;
+			maxX.head = maxX.count = maxY.head = maxY.count = 0;
+			*rangeX = *rangeY = Axis::AutoRange();
+		}
+		void push(double px, double py) {
+			x[next] = x[next + capacity] = px;
+			y[next] = y[next + capacity] = py;
+			if (++next == capacity) next = 0;
+			if (count < capacity) ++count;
+
+			size_t index = pushed++, windowStart = pushed - count;
+			minX.push(index, px, windowStart);
+			maxX.push(index, px, windowStart);
+			minY.push(index, py, windowStart);
+			maxY.push(index, py, windowStart);
+			*rangeX = *rangeY = Axis::AutoRange();
+			if (!minX.empty()) rangeX->add(minX.front());
+			if (!maxX.empty()) rangeX->add(maxX.front());
+			if (!minY.empty()) rangeY->add(minY.front());
+			if (!maxY.empty()) rangeY->add(maxY.front());
+		}
+		/// Start of the window (oldest point) within `x`/`y`
+		size_t start() const {
+			return (count < capacity) ? 0 : next;
+		}
+		size_t memoryBytes() const {
+			return (x.capacity() + y.capacity())*sizeof(double) + (minX.ring.capacity() + minY.ring.capacity() + maxX.ring.capacity() + maxY.ring.capacity())*sizeof(WindowExtreme<true>::Entry);
+		}
 	};
-	std::vector<LinePoint> points;
+	RollingPoints rollingPoints;
 	struct Marker {
 		Point2D point;
 		int shape;
@@ -1070,19 +3282,326 @@ class Line2D : public SvgDrawable {
 		double c;
 	};
 	std::vector<Dot> dots;
-	struct Frame {
-		double time = 0.0;
-		std::vector<LinePoint> points;
+	/// Read-only view of a contiguous array
+	template<class T>
+	struct ArraySpan {
+		const T *data;
+		size_t count;
+
+		size_t size() const {
+			return count;
+		}
+		const T & operator[](size_t i) const {
+			return data[i];
+		}
+	};
+	/// A range of points within a `LinePoints`, with sub-path indices relative to the start of the range
+	struct PointSpan {
+		const LinePoints &points;
+		size_t start, count;
+		ArraySpan<size_t> moves; // absolute indices
+
+		PointSpan(const LinePoints &points) : PointSpan(points, 0, points.size(), 0, points.moves.size()) {}
+		PointSpan(const LinePoints &points, size_t start, size_t end, size_t moveStart, size_t moveEnd) : points(points), start(start), count(end - start), moves{points.moves.data() + moveStart, moveEnd - moveStart} {}
+
+		size_t size() const {
+			return count;
+		}
+		size_t moveCount() const {
+			return moves.size();
+		}
+		/// Index of the first point in sub-path `s`
+		size_t moveStart(size_t s) const {
+			return moves[s] - start;
+		}
+		/// Index one past the end of sub-path `s`
+		size_t moveEnd(size_t s) const {
+			return (s + 1 < moves.size()) ? moves[s + 1] - start : count;
+		}
+		void map(const Axis &axisX, const Axis &axisY, size_t i, double *outX, double *outY, size_t length) const {
+			points.x.map(axisX, start + i, outX, length);
+			points.y.map(axisY, start + i, outY, length);
+		}
+	};
+	/** Animation frames are offsets into contiguous blocks of storage.  Blocks are never reallocated (so frames aren't copied again as the animation grows), and are kept when frames are cleared.
+		This means capturing a frame doesn't allocate once the storage has grown, and the live buffers keep their capacity. */
+	struct FrameBlock {
+		LinePoints points;
 		std::vector<Marker> markers;
 		std::vector<Dot> dots;
-		Frame() {}
-		Frame(double time, std::vector<LinePoint> points, std::vector<Marker> markers, std::vector<Dot> dots) : time(time), points(points), markers(markers), dots(dots) {}
+
+		bool fits(const LinePoints &p, size_t markerCount, size_t dotCount) const {
+			size_t pointCount = points.size() + p.size();
+			return pointCount <= points.x.capacity() && pointCount <= points.y.capacity()
+				&& points.moves.size() + p.moves.size() <= points.moves.capacity()
+				&& markers.size() + markerCount <= markers.capacity()
+				&& dots.size() + dotCount <= dots.capacity();
+		}
+		void clear() {
+			points.clear();
+			markers.clear();
+			dots.clear();
+		}
+	};
+	struct Frame {
+		double time;
+		size_t block;
+		size_t pointStart, pointEnd, moveStart, moveEnd;
+		size_t markerStart, markerEnd, dotStart, dotEnd;
 	};
 	double framesLoopTime = 0;
 	std::vector<Frame> frames;
+	std::vector<std::unique_ptr<FrameBlock>> frameBlocks;
+	size_t frameBlockIndex = 0;
+	FrameBlock & frameBlockFor(const LinePoints &p, size_t markerCount, size_t dotCount) {
+		while (frameBlockIndex < frameBlocks.size()) {
+			if (frameBlocks[frameBlockIndex]->fits(p, markerCount, dotCount)) return *frameBlocks[frameBlockIndex];
+			++frameBlockIndex;
+		}
+		// Each new block is at least double the previous one
+		FrameBlock *block = new FrameBlock();
+		frameBlocks.emplace_back(block);
+		block->points.x.setFloat(points.x.useFloat);
+		block->points.y.setFloat(points.y.useFloat);
+		if (frameBlockIndex > 0) {
+			auto &prev = *frameBlocks[frameBlockIndex - 1];
+			block->points.x.reserve(prev.points.x.capacity()*2);
+			block->points.y.reserve(prev.points.y.capacity()*2);
+			block->points.moves.reserve(prev.points.moves.capacity()*2);
+			block->markers.reserve(prev.markers.capacity()*2);
+			block->dots.reserve(prev.dots.capacity()*2);
+		}
+		if (block->points.x.capacity() < p.size()) block->points.x.reserve(p.size());
+		if (block->points.y.capacity() < p.size()) block->points.y.reserve(p.size());
+		if (block->points.moves.capacity() < p.moves.size()) block->points.moves.reserve(p.moves.size());
+		if (block->markers.capacity() < markerCount) block->markers.reserve(markerCount);
+		if (block->dots.capacity() < dotCount) block->dots.reserve(dotCount);
+		return *block;
+	}
+	struct FrameView {
+		double time;
+		PointSpan points;
+		ArraySpan<Marker> markers;
+		ArraySpan<Dot> dots;
+	};
+	FrameView frameView(size_t index) const {
+		const Frame &frame = frames[index];
+		const FrameBlock &block = *frameBlocks[frame.block];
+		return {
+			frame.time,
+			PointSpan(block.points, frame.pointStart, frame.pointEnd, frame.moveStart, frame.moveEnd),
+			{block.markers.data() + frame.markerStart, frame.markerEnd - frame.markerStart},
+			{block.dots.data() + frame.dotStart, frame.dotEnd - frame.dotStart}
+		};
+	}
+	Line2D & addRolling(double x, double y) {
+		auto &roll = rollingPoints;
+		roll.push(x, y);
+		// Points become a view of the (contiguous) window
+		size_t start = roll.start();
+		points.x.view(roll.x.data() + start, roll.count, 1);
+		points.y.view(roll.y.data() + start, roll.count, 1);
+		if (points.moves.empty()) points.moves.push_back(0);
+		nextIsMove = false;
+		xOrder.reset();
+		return *this;
+	}
 	Point2D latest{0, 0};
 	bool nextIsMove = true;
+	double decimateWidth = 0;
+
+	/// Maps points to the screen in blocks, using the batch `Axis::map()`
+	struct ScreenPoints {
+		const PointSpan &points;
+		Axis &axisX, &axisY;
+		static constexpr size_t blockLength = 256;
+		size_t blockStart = 0, blockEnd = 0;
+		double blockX[blockLength], blockY[blockLength];
+
+		ScreenPoints(const PointSpan &points, Axis &axisX, Axis &axisY) : points(points), axisX(axisX), axisY(axisY) {}
+
+		double x(size_t i) {
+			if (i < blockStart || i >= blockEnd) mapBlock(i);
+			return blockX[i - blockStart];
+		}
+		double y(size_t i) {
+			if (i < blockStart || i >= blockEnd) mapBlock(i);
+			return blockY[i - blockStart];
+		}
+	private:
+		void mapBlock(size_t i) {
+			blockStart = i - i%blockLength; // aligned, so reverse iteration works too
+			size_t length = std::min(size_t(blockLength), points.size() - blockStart);
+			blockEnd = blockStart + length;
+			points.map(axisX, axisY, blockStart, blockX, blockY, length);
+		}
+	};
+
+	/// Reduces runs of (screen-space) points to the first/min/max/last within each column (or row)
+	struct Decimator {
+		SvgWriter &svg;
+		double width;
+		bool byRow, alwaysInclude;
+		
+		Decimator(SvgWriter &svg, double width, bool byRow, bool alwaysInclude) : svg(svg), width(width), byRow(byRow), alwaysInclude(alwaysInclude) {}
+
+		void add(double x, double y) {
+			if (width <= 0) return svg.addPoint(x, y, alwaysInclude);
+			if (std::isnan(x) || std::isnan(y)) return;
+			double key = byRow ? y : x, value = byRow ? x : y;
+			double column = std::floor(key/width);
+			if (count > 0 && column == currentColumn) {
+				if (value < minValue) {
+					minValue = value;
+					points[1] = {x, y};
+					minIndex = count;
+				}
+				if (value > maxValue) {
+					maxValue = value;
+					points[2] = {x, y};
+					maxIndex = count;
+				}
+				points[3] = {x, y};
+				++count;
+			} else {
+				flush();
+				currentColumn = column;
+				minValue = maxValue = value;
+				points[0] = points[1] = points[2] = points[3] = {x, y};
+				minIndex = maxIndex = 0;
+				count = 1;
+			}
+		}
+		/// Writes any pending points - must be called before anything else is added to the path
+		void flush() {
+			if (!count) return;
+			svg.addPoint(points[0].x, points[0].y, alwaysInclude);
+			size_t first = std::min(minIndex, maxIndex), second = std::max(minIndex, maxIndex);
+			Point2D &firstPoint = points[(minIndex < maxIndex) ? 1 : 2], &secondPoint = points[(minIndex < maxIndex) ? 2 : 1];
+			if (first > 0 && first < count - 1) svg.addPoint(firstPoint.x, firstPoint.y, alwaysInclude);
+			if (second > first && second < count - 1) svg.addPoint(secondPoint.x, secondPoint.y, alwaysInclude);
+			if (count > 1) svg.addPoint(points[3].x, points[3].y, alwaysInclude);
+			count = 0;
+		}
+	private:
+		Point2D points[4]; // first, min, max, last
+		size_t count = 0, minIndex = 0, maxIndex = 0;
+		double currentColumn = 0, minValue = 0, maxValue = 0;
+	};
 	
+	/// Writes the dots grouped by (quantised) colour and radius, with each group as a single path (see `PlotStyle::compactDots`)
+	void writeCompactDots(SvgWriter &svg, const PlotStyle &style) {
+		struct Entry {
+			int colour; // -1 for no colour
+			double x, y, r;
+		};
+		double xMin = axisX.drawMin(), xMax = axisX.drawMax();
+		double yMin = axisY.drawMin(), yMax = axisY.drawMax();
+		int colourSteps = std::max(style.compactDotColours, 2);
+		std::vector<Entry> entries;
+		entries.reserve(dots.size());
+		for (auto &dot : dots) {
+			double x = axisX.map(dot.x), y = axisY.map(dot.y), r = svg.round(dot.screenR);
+			// Skip anything which would be entirely clipped
+			if (!(r > 0) || x + r < xMin || x - r > xMax || y + r < yMin || y - r > yMax) continue;
+			int colour = -1;
+			if (dot.hasColour) {
+				double c = 0.5 + (dot.c - 0.5)*style.dotCmapDepth;
+				colour = int(std::round(std::max(0.0, std::min(1.0, c))*(colourSteps - 1)));
+			}
+			entries.push_back({colour, x, y, r});
+		}
+		std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+			return (a.colour != b.colour) ? a.colour < b.colour : a.r < b.r;
+		});
+
+		svg.tag("g").attr("class", "svg-plot-dot");
+		auto writeGroup = [&](size_t start, size_t end) {
+			int colour = entries[start].colour;
+			bool hasC = (colour >= 0);
+			if (hasC) svg.translateCmap(style, colour/double(colourSteps - 1));
+			// The shape is written once, and referenced for the fill and the border
+			auto id = svg.elementId("dots");
+			svg.raw("<defs><path").attr("id", id).raw(" d=\"");
+			double r = entries[start].r;
+			for (size_t i = start; i < end; ++i) {
+				// Two half-circle arcs, starting from the left-hand edge
+				svg.raw("M");
+				svg.rawRounded(entries[i].x - r).raw(" ").rawRounded(entries[i].y);
+				svg.raw("a").rawRounded(r).raw(" ").rawRounded(r).raw(" 0 1 0 ").rawRounded(2*r).raw(" 0 ");
+				svg.rawRounded(r).raw(" ").rawRounded(r).raw(" 0 1 0-").rawRounded(2*r).raw(" 0");
+			}
+			svg.raw("\"/></defs>");
+			if (_drawFill) {
+				auto use = svg.tag("use", true).attr("href", "#", id)
+					.attr("class", "svg-plot-fill ", style.fillClass(styleIndex), " ", style.hatchClass(styleIndex), hasC ? " svg-plot-cmap" : "");
+				if (hasC) use.attr("style", "fill:", svg.cmapStr);
+			}
+			if (_drawLine) {
+				auto use = svg.tag("use", true).attr("href", "#", id)
+					.attr("class", "svg-plot-line ", style.strokeClass(styleIndex), hasC ? " svg-plot-cmap" : "");
+				if (hasC) use.attr("style", "stroke:", svg.cmapStr);
+			}
+		};
+		size_t start = 0;
+		while (start < entries.size()) {
+			size_t end = start + 1;
+			while (end < entries.size() && entries[end].colour == entries[start].colour && entries[end].r == entries[start].r) ++end;
+			writeGroup(start, end);
+			start = end;
+		}
+		svg.raw("</g>");
+	}
+
+	/// Values for an animation: the frame index (or -1 for the blank value) and time (0-1)
+	struct AnimationKey {
+		int frame;
+		double time;
+	};
+	std::vector<AnimationKey> animationKeys() const {
+		std::vector<AnimationKey> keys;
+		double lastFrame = frames.back().time;
+		double framesEnd = std::max(framesLoopTime, lastFrame);
+		bool repeatEnd = (framesLoopTime > lastFrame || smoothFrame);
+		bool blankZero = (frames[0].time > 0);
+		if (blankZero) keys.push_back({-1, 0});
+		for (size_t i = 0; i < frames.size(); ++i) {
+			keys.push_back({int(i), frames[i].time/framesEnd});
+		}
+		if (repeatEnd) keys.push_back({blankZero ? -1 : 0, 1});
+		return keys;
+	}
+	/** Renders each animation value, merging runs of identical values into a single longer span.
+		When interpolating, the end of each run is kept too (so the value is constant until then), and the final value is always kept. */
+	template<class WriteValue, class Emit>
+	void mergedAnimationValues(SvgWriter &svg, WriteValue &&writeValue, const char *blankValue, Emit &&emit) {
+		auto &output = svg.rawOutput();
+		auto keys = animationKeys();
+		std::string prevValue;
+		double pendingTime = -1; // latest time in a run of duplicates
+		for (size_t k = 0; k < keys.size(); ++k) {
+			output.hold();
+			size_t start = output.heldPosition();
+			if (keys[k].frame < 0) {
+				svg.raw(blankValue);
+			} else {
+				writeValue(keys[k].frame);
+			}
+			std::string value = output.takeHeld(start);
+			output.release();
+
+			bool duplicate = (k > 0 && value == prevValue);
+			if (duplicate && k + 1 < keys.size()) {
+				pendingTime = keys[k].time;
+				continue;
+			}
+			if (smoothFrame && !duplicate && pendingTime >= 0) emit(prevValue, pendingTime);
+			pendingTime = -1;
+			emit(value, keys[k].time);
+			prevValue = std::move(value);
+		}
+	}
+
 	template<class WriteValue>
 	void writeAnimationAttrs(SvgWriter &svg, WriteValue &&writeValue, const char *blankValue) {
 		double lastFrame = frames.back().time;
@@ -1093,49 +3612,124 @@ class Line2D : public SvgDrawable {
 			svg.attr("dur", framesEnd);
 		}
 		svg.raw(" values=\"");
-		bool repeatEnd = (framesLoopTime > lastFrame || smoothFrame);
-		bool blankZero = (frames[0].time > 0);
-		if (blankZero) {
-			svg.raw(blankValue);
-			svg.raw(";");
-		}
-		for (size_t i = 0; i < frames.size(); ++i) {
+		std::vector<double> keyTimes;
+		mergedAnimationValues(svg, writeValue, blankValue, [&](const std::string &value, double time) {
+			if (keyTimes.size()) svg.raw(";");
+			svg.raw(value);
+			keyTimes.push_back(time);
+		});
+		svg.raw("\" keyTimes=\"");
+		for (size_t i = 0; i < keyTimes.size(); ++i) {
 			if (i > 0) svg.raw(";");
-			writeValue(int(i));
+			svg.write(keyTimes[i]);
 		}
-		if (repeatEnd) {
-			svg.raw(";");
-			if (blankZero) {
-				svg.raw(blankValue);
+	}
+
+	/// Splits a path into tokens (commands and numbers)
+	static void pathTokens(const std::string &path, std::vector<std::string> &tokens) {
+		tokens.clear();
+		size_t i = 0;
+		while (i < path.size()) {
+			char c = path[i];
+			if (c == ' ' || c == ',') {
+				++i;
+			} else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+				tokens.emplace_back(1, c);
+				++i;
 			} else {
-				writeValue(0);
+				size_t start = i++;
+				while (i < path.size()) {
+					char n = path[i];
+					bool exponentSign = (n == '-' || n == '+') && (path[i - 1] == 'e' || path[i - 1] == 'E');
+					if (!exponentSign && !(n >= '0' && n <= '9') && n != '.' && n != 'e' && n != 'E') break;
+					++i;
+				}
+				tokens.push_back(path.substr(start, i - start));
 			}
 		}
-		svg.raw("\" keyTimes=\"");
-		if (blankZero) svg.raw("0;");
-		for (size_t i = 0; i < frames.size(); ++i) {
+	}
+	/** Writes the animation as `data-svg-plot-*` attributes for the script player (see `PlotStyle::scriptAnimation`).
+		Each frame is either a keyframe (a complete path) or a list of changed tokens relative to the latest keyframe, as `skip token token...` groups separated by commas. */
+	template<class WriteValue>
+	void writeAnimationData(SvgWriter &svg, WriteValue &&writeValue, const char *blankValue) {
+		double framesEnd = std::max(framesLoopTime, frames.back().time);
+		svg.attr("data-svg-plot-dur", framesEnd);
+		if (framesLoopTime > 0) svg.attr("data-svg-plot-loop", 1);
+		if (smoothFrame) svg.attr("data-svg-plot-smooth", 1);
+
+		std::string encoded;
+		std::vector<double> times;
+		std::vector<std::string> keyTokens, tokens;
+		size_t keyLength = 0;
+		mergedAnimationValues(svg, writeValue, blankValue, [&](const std::string &value, double time) {
+			if (times.size()) encoded += ';';
+			times.push_back(time);
+			pathTokens(value, tokens);
+			std::string delta;
+			if (tokens.size() == keyTokens.size()) {
+				size_t pos = 0;
+				for (size_t i = 0; i < tokens.size() && delta.size() < keyLength/2; ++i) {
+					if (tokens[i] == keyTokens[i]) continue;
+					if (delta.size()) delta += ',';
+					delta += std::to_string(i - pos);
+					while (i < tokens.size() && tokens[i] != keyTokens[i]) {
+						delta += ' ';
+						delta += tokens[i++];
+					}
+					pos = i;
+				}
+				if (delta.size() < keyLength/2) {
+					encoded += delta;
+					return;
+				}
+			}
+			// New keyframe
+			encoded += value;
+			std::swap(keyTokens, tokens);
+			keyLength = value.size();
+		});
+		svg.raw(" data-svg-plot-times=\"");
+		for (size_t i = 0; i < times.size(); ++i) {
 			if (i > 0) svg.raw(";");
-			svg.write(frames[i].time/framesEnd);
+			svg.write(times[i]);
 		}
-		if (repeatEnd) svg.raw(";1");
+		svg.raw("\" data-svg-plot-frames=\"").raw(encoded).raw("\"");
 	}
 public:
 	PlotStyle::Counter styleIndex;
 
-	Line2D(Axis &axisX, Axis &axisY, PlotStyle::Counter styleIndex) : axisX(axisX), axisY(axisY), styleIndex(styleIndex) {}
+	Line2D(Axis &axisX, Axis &axisY, PlotStyle::Counter styleIndex) : axisX(axisX), axisY(axisY), styleIndex(styleIndex) {
+		axisX.autoRange(autoX);
+		axisY.autoRange(autoY);
+	}
 	
 	Line2D & add(double x, double y) {
 		latest = {x, y};
-		points.push_back({x, y, nextIsMove});
+		if (rollingPoints.capacity) return addRolling(x, y);
+		points.add(x, y, nextIsMove);
 		nextIsMove = false;
-		axisX.autoValue(x);
-		axisY.autoValue(y);
+		autoX->add(x);
+		autoY->add(y);
 		return *this;
 	}
 
+	/// Adds points from arrays/pointers/containers of any numeric type, converting them in bulk
 	template<class X, class Y>
 	Line2D & addArray(X &&x, Y &&y, size_t size) {
-		for (size_t i = 0; i < size; ++i) add(x[i], y[i]);
+		if (!size) return *this;
+		if (rollingPoints.capacity) {
+			for (size_t i = 0; i < size; ++i) add(double(x[i]), double(y[i]));
+			return *this;
+		}
+		size_t start = points.size();
+		if (nextIsMove || !start) points.moves.push_back(start);
+		nextIsMove = false;
+		points.x.append(x, size);
+		points.y.append(y, size);
+		// Reduce the (converted) new values, rather than registering each one with the axes
+		points.x.addRange(*autoX, start);
+		points.y.addRange(*autoY, start);
+		latest = {double(x[size - 1]), double(y[size - 1])};
 		return *this;
 	}
 	template<class X, class Y>
@@ -1153,11 +3747,70 @@ public:
 		return latest;
 	}
 
+	/** Plots external data without copying it, replacing any existing points.  The `x`/`y` pointers can be `double` or `float`, and the strides are in elements.
+		The data must stay valid until the plot has been written.  Adding more points afterwards will copy the data into the line. */
+	template<class X, class Y>
+	Line2D & borrow(const X *x, const Y *y, size_t size, size_t strideX=1, size_t strideY=1) {
+		rolling(0);
+		points.clear();
+		xOrder.reset();
+		points.x.view(x, size, strideX);
+		points.y.view(y, size, strideY);
+		if (!size) return *this;
+		points.moves.push_back(0);
+		nextIsMove = false;
+		latest = {points.x[size - 1], points.y[size - 1]};
+		// One pass to find the auto-scale range
+		points.x.addRange(*autoX);
+		points.y.addRange(*autoY);
+		return *this;
+	}
+
+	/** Keeps only the latest `capacity` points, in a fixed buffer which is rendered oldest-to-newest without reallocating.  This is for live plots which are re-written as data arrives.
+		The line's auto-scale range only includes points still in the window (using monotonic min/max queues, not a rescan) - but axes only auto-scale once, so call `Axis::autoRescale()` before re-writing.
+		Rolling lines are a single sub-path (`.cut()` is ignored), and a capacity of 0 returns to normal storage.  Any existing points are cleared. */
+	Line2D & rolling(size_t capacity) {
+		if (!capacity && !rollingPoints.capacity) return *this;
+		points.clear();
+		xOrder.reset();
+		nextIsMove = true;
+		rollingPoints.reset(capacity);
+		if (capacity && !rollingPoints.registered) {
+			axisX.autoRange(rollingPoints.rangeX);
+			axisY.autoRange(rollingPoints.rangeY);
+			rollingPoints.registered = true;
+		}
+		return *this;
+	}
+
+	/** Stores x and/or y values as `float`s, which halves the memory used (existing values are converted).
+		Single-precision is usually enough for y, since the output precision is limited anyway - but it might not be for x-values with a large offset (e.g. sample indices in the millions). */
+	Line2D & floatStorage(bool floatX=true, bool floatY=true) {
+		points.x.setFloat(floatX);
+		points.y.setFloat(floatY);
+		for (auto &block : frameBlocks) {
+			block->points.x.setFloat(floatX);
+			block->points.y.setFloat(floatY);
+		}
+		xOrder.reset();
+		return *this;
+	}
+
+	/// Approximate memory used by the line's data (points, markers, dots and animation frames), in bytes
+	size_t memoryBytes() const {
+		auto frameBytes = [](const LinePoints &points, const std::vector<Marker> &markers, const std::vector<Dot> &dots) {
+			return points.memoryBytes() + markers.capacity()*sizeof(Marker) + dots.capacity()*sizeof(Dot);
+		};
+		size_t bytes = frameBytes(points, markers, dots) + frames.capacity()*sizeof(Frame) + rollingPoints.memoryBytes();
+		for (auto &block : frameBlocks) bytes += frameBytes(block->points, block->markers, block->dots);
+		return bytes;
+	}
+
 	Line2D & marker(double x, double y, int shape=-1) {
 		latest = {x, y};
 		markers.push_back({{x, y}, shape});
-		axisX.autoValue(x);
-		axisY.autoValue(y);
+		autoX->add(x);
+		autoY->add(y);
 		return *this;
 	}
 
@@ -1167,8 +3820,8 @@ public:
 	Line2D & dot(double x, double y, double screenR) {
 		latest = {x, y};
 		dots.push_back({x, y, screenR, false, 0});
-		axisX.autoValue(x);
-		axisY.autoValue(y);
+		autoX->add(x);
+		autoY->add(y);
 		return *this;
 	}
 
@@ -1176,14 +3829,21 @@ public:
 	Line2D & dot(double x, double y, double screenR, double unitColour) {
 		latest = {x, y};
 		dots.push_back({x, y, screenR, true, unitColour});
-		axisX.autoValue(x);
-		axisY.autoValue(y);
+		autoX->add(x);
+		autoY->add(y);
 		return *this;
 	}
 
 	/// Flag to attempt interpolation of the path between frames
 	bool smoothFrame = false;
 
+	/** Only draws the first/min/max/last point in each screen column (or row, if filling to an X value), for dense data.
+		The `width` is in screen units (before scaling by `PlotStyle::scale`).  This has no effect when `.smoothFrame` is set, since the number of points must be consistent between frames. */
+	Line2D & decimate(double width=1) {
+		decimateWidth = width;
+		return *this;
+	}
+
 	/// @{
 	///@name Draw config
 
@@ -1226,8 +3886,17 @@ public:
 		double degrees, distance;
 		Point2D drawLineFrom{0, 0}, drawLineTo{0, 0};
 		PlotStyle::Counter &styleIndex;
+		// What the layout was based on: the axes can belong to another plot, and the style index can be changed directly
+		Axis::LayoutState layoutX, layoutY;
+		PlotStyle::Counter layoutStyle;
 	protected:
+		bool layoutChanged() override {
+			return axisX.layoutState() != layoutX || axisY.layoutState() != layoutY || styleIndex != layoutStyle;
+		}
 		void layout(const PlotStyle &style) override {
+			layoutX = axisX.layoutState();
+			layoutY = axisY.layoutState();
+			layoutStyle = styleIndex;
 			double sx = axisX.map(at.x), sy = axisY.map(at.y);
 			if (distance < 0) {
 				this->alignment = 0;
@@ -1293,7 +3962,7 @@ public:
 	Line2D & label(double valueX, double valueY, std::string name, double degrees, double distance=0) {
 		axisX.autoValue(valueX);
 		axisY.autoValue(valueY);
-		this->addChild(new LineLabel(axisX, axisY, {valueX, valueY}, name, degrees, distance, styleIndex));
+		this->addChild(this->create<LineLabel>(axisX, axisY, Point2D{valueX, valueY}, name, degrees, distance, styleIndex));
 		return *this;
 	}
 
@@ -1304,16 +3973,31 @@ public:
 
 	/// Adds a label using the closest (line) point to the given x-axis position
 	Line2D & label(double xIsh, std::string name, double degrees=0, double distance=0) {
-		size_t closest = 0;
-		double closestError = -1;
-		for (size_t i = 0; i < points.size(); ++i) {
-			if (closestError < 0 || closestError > std::abs(points[i].x - xIsh)) {
-				closest = i;
-				closestError = std::abs(points[i].x - xIsh);
-			}
-		}
-        LinePoint latest = points[closest];
-		return label(latest.x, latest.y, name, degrees, distance);
+		Point2D at = nearest(xIsh);
+		return label(at.x, at.y, name, degrees, distance);
+	}
+	/// Adds a label using the closest (line) point to the given position - see `.nearest(x, y)`
+	Line2D & labelNearest(double xIsh, double yIsh, std::string name, double degrees=0, double distance=0) {
+		Point2D at = nearest(xIsh, yIsh);
+		return label(at.x, at.y, name, degrees, distance);
+	}
+
+	/** The (line) point closest to the given x-axis position, or the latest point if there aren't any.
+		This uses a binary search if the x-values are ascending, otherwise a sorted index which is built on first use. */
+	Point2D nearest(double xIsh) {
+		size_t i = xOrder.nearestX(points, xIsh);
+		if (i >= points.size()) return latest;
+		return {points.x[i], points.y[i]};
+	}
+	/** The (line) point closest to the given position, or the latest point if there aren't any.
+		Distances are relative to the data's extent in each direction, so that both axes count equally. */
+	Point2D nearest(double xIsh, double yIsh) {
+		auto scale = [](const Axis::AutoRange &range) {
+			return (range.max > range.min) ? 1/(range.max - range.min) : 1.0;
+		};
+		size_t i = xOrder.nearest(points, xIsh, yIsh, scale(*autoX), scale(*autoY));
+		if (i >= points.size()) return latest;
+		return {points.x[i], points.y[i]};
 	}
 	
 	/// @{
@@ -1321,9 +4005,27 @@ public:
 
 	void toFrame(double time, bool clear=true) override {
 		SvgDrawable::toFrame(time, clear);
-		frames.push_back(Frame{time, points, markers, dots});
+		FrameBlock &block = frameBlockFor(points, markers.size(), dots.size());
+		Frame frame{time, frameBlockIndex, block.points.size(), 0, block.points.moves.size(), 0, block.markers.size(), 0, block.dots.size(), 0};
+		block.points.append(points);
+		block.markers.insert(block.markers.end(), markers.begin(), markers.end());
+		block.dots.insert(block.dots.end(), dots.begin(), dots.end());
+		frame.pointEnd = block.points.size();
+		frame.moveEnd = block.points.moves.size();
+		frame.markerEnd = block.markers.size();
+		frame.dotEnd = block.dots.size();
+		frames.push_back(frame);
 		if (clear) {
+			// The rolling window's range only covers the current frame, so keep it (like other points do) before clearing
+			if (rollingPoints.count) {
+				autoX->add(rollingPoints.rangeX->min);
+				autoX->add(rollingPoints.rangeX->max);
+				autoY->add(rollingPoints.rangeY->min);
+				autoY->add(rollingPoints.rangeY->max);
+			}
 			points.clear();
+			rollingPoints.clear();
+			xOrder.reset();
 			markers.clear();
 			dots.clear();
 			latest = {0, 0};
@@ -1338,6 +4040,8 @@ public:
 	void clearFrames() override {
 		SvgDrawable::clearFrames();
 		frames.resize(0);
+		for (auto &block : frameBlocks) block->clear();
+		frameBlockIndex = 0;
 		framesLoopTime = 0;
 	}
 	
@@ -1346,8 +4050,8 @@ public:
 		double yMin = axisY.drawMin(), yMax = axisY.drawMax();
 		size_t maxMarkers = markers.size();
 		bool animated = (frames.size() > 0);
-		for (auto &frame : frames) {
-			maxMarkers = std::max(maxMarkers, frame.markers.size());
+		for (size_t f = 0; f < frames.size(); ++f) {
+			maxMarkers = std::max(maxMarkers, frameView(f).markers.size());
 		}
 		static constexpr double outOfRange = -10000;
 		const char *neutralValue = "-10000 -10000";
@@ -1367,7 +4071,7 @@ public:
 			if (animated || x != outOfRange || y != outOfRange) {
 				if (!animated) {
 					svg.tag("use", true)
-						.attr("href", "#", style.markerId(shape))
+						.attr("href", svg.defsHref, "#", style.markerId(shape))
 						.attr("class", style.fillClass(styleIndex), " ", style.strokeClass(styleIndex))
 						.attr("transform", "translate(", x, " ", y, ")");
 				} else {
@@ -1382,9 +4086,9 @@ public:
 						.attr("type", "translate");
 					writeAnimationAttrs(svg, [&](int index) {
 						double x = outOfRange, y = outOfRange;
-						if (m < frames[index].markers.size()) {
-							x = axisX.map(frames[index].markers[m].point.x);
-							y = axisY.map(frames[index].markers[m].point.y);
+						if (m < frameView(index).markers.size()) {
+							x = axisX.map(frameView(index).markers[m].point.x);
+							y = axisY.map(frameView(index).markers[m].point.y);
 							if (x < xMin || x > xMax || y < yMin || y > yMax) {
 								x = y = outOfRange;
 							}
@@ -1399,66 +4103,92 @@ public:
 	}
 	
 	void writeData(SvgWriter &svg, const PlotStyle &style) override {
-		auto writePoints = [&](std::vector<LinePoint> &points, bool fill) {
+		double columnWidth = smoothFrame ? 0 : decimateWidth/style.scale;
+		auto writePoints = [&](const PointSpan &points, bool fill) {
 			if (!points.size()) {
 				svg.raw("M0 0");
 				return;
 			}
+			Decimator decimator(svg, columnWidth, hasFillToX, smoothFrame);
+			ScreenPoints screen(points, axisX, axisY);
 			if (fill && fillToLine) { // Ignore path cuts
-				svg.startPath();
-				for (auto &p : points) {
-					svg.addPoint(axisX.map(p.x), axisY.map(p.y), smoothFrame);
+				svg.startPath(!smoothFrame);
+				for (size_t i = 0; i < points.size(); ++i) {
+					decimator.add(screen.x(i), screen.y(i));
 				}
 				// Other line in reverse order
-				auto &otherPoints = fillToLine->points;
-				for (int i = int(otherPoints.size()) - 1; i >= 0; --i) {
-					auto &p = otherPoints[i];
-					svg.addPoint(fillToLine->axisX.map(p.x), fillToLine->axisY.map(p.y), (smoothFrame || i == 0));
+				PointSpan otherPoints(fillToLine->points);
+				ScreenPoints otherScreen(otherPoints, fillToLine->axisX, fillToLine->axisY);
+				for (size_t i = otherPoints.size() - 1; i + 1 > 1; --i) {
+					decimator.add(otherScreen.x(i), otherScreen.y(i));
+				}
+				decimator.flush();
+				if (otherPoints.size()) {
+					svg.addPoint(otherScreen.x(0), otherScreen.y(0), true);
 				}
 			} else if (fill && hasFillToX) {
-				for (size_t i = 0; i < points.size(); ++i) {
-					auto &p = points[i];
-					if (p.isMove) svg.startPath();
-					if (p.isMove) svg.addPoint(axisX.map(fillToPoint.x), axisY.map(p.y), true);
-					// Actual point
-					svg.addPoint(axisX.map(p.x), axisY.map(p.y), smoothFrame);
-
-					bool nextIsMove = (i + 1 == points.size() || points[i + 1].isMove);
-					if (nextIsMove) svg.addPoint(axisX.map(fillToPoint.x), axisY.map(p.y), true);
+				double fillX = axisX.map(fillToPoint.x);
+				for (size_t s = 0; s < points.moveCount(); ++s) {
+					size_t start = points.moveStart(s), end = points.moveEnd(s);
+					svg.startPath(!smoothFrame);
+					svg.addPoint(fillX, screen.y(start), true);
+					for (size_t i = start; i < end; ++i) {
+						decimator.add(screen.x(i), screen.y(i));
+					}
+					decimator.flush();
+					svg.addPoint(fillX, screen.y(end - 1), true);
 				}
 			} else if (fill && hasFillToY) {
-				for (size_t i = 0; i < points.size(); ++i) {
-					auto &p = points[i];
-					if (p.isMove) svg.startPath();
-					if (p.isMove) svg.addPoint(axisX.map(p.x), axisY.map(fillToPoint.y), true);
-					// Actual point
-					svg.addPoint(axisX.map(p.x), axisY.map(p.y), smoothFrame);
-
-					bool nextIsMove = (i + 1 == points.size() || points[i + 1].isMove);
-					if (nextIsMove) svg.addPoint(axisX.map(p.x), axisY.map(fillToPoint.y), true);
+				double fillY = axisY.map(fillToPoint.y);
+				for (size_t s = 0; s < points.moveCount(); ++s) {
+					size_t start = points.moveStart(s), end = points.moveEnd(s);
+					svg.startPath(!smoothFrame);
+					svg.addPoint(screen.x(start), fillY, true);
+					for (size_t i = start; i < end; ++i) {
+						decimator.add(screen.x(i), screen.y(i));
+					}
+					decimator.flush();
+					svg.addPoint(screen.x(end - 1), fillY, true);
 				}
 			} else {
-				for (auto &p : points) {
-					if (p.isMove) svg.startPath();
-					svg.addPoint(axisX.map(p.x), axisY.map(p.y), smoothFrame);
+				for (size_t s = 0; s < points.moveCount(); ++s) {
+					size_t start = points.moveStart(s), end = points.moveEnd(s);
+					decimator.flush();
+					svg.startPath(!smoothFrame);
+					for (size_t i = start; i < end; ++i) {
+						decimator.add(screen.x(i), screen.y(i));
+					}
 				}
 			}
+			decimator.flush();
 			svg.endPath();
 		};
 		auto writeD = [&](bool fill){
-			auto &p = (points.size() || !frames.size()) ? points : frames.back().points;
+			PointSpan p = (points.size() || !frames.size()) ? PointSpan(points) : frameView(frames.size() - 1).points;
+			auto encoding = svg.pathEncoding;
+			if (fill && encoding == PlotStyle::PathEncoding::scaledInteger) {
+				svg.pathEncoding = PlotStyle::PathEncoding::relative; // a transform would scale the hatching too
+			}
+			svg.pathAttrs();
 			svg.raw(" d=\"");
 			writePoints(p, fill);
-			if (frames.size() > 0) {
+			if (frames.size() > 0 && style.scriptAnimation) {
+				svg.raw("\"");
+				writeAnimationData(svg, [&](size_t i) {
+					writePoints(frameView(i).points, fill);
+				}, "M0 0");
+				svg.raw("/>");
+			} else if (frames.size() > 0) {
 				svg.raw("\">\n<animate")
 					.attr("attributeName", "d").attr("calcMode", smoothFrame ? "linear" : "discrete");
 				writeAnimationAttrs(svg, [&](size_t i) {
-					writePoints(frames[i].points, fill);
+					writePoints(frameView(i).points, fill);
 				}, "M0 0");
 				svg.raw("\"/></path>");
 			} else {
 				svg.raw("\"/>");
 			}
+			svg.pathEncoding = encoding;
 		};
 		
 		if (_drawFill) {
@@ -1474,10 +4204,12 @@ public:
 
 		size_t maxDots = dots.size();
 		bool animated = (frames.size() > 0);
-		for (auto &frame : frames) {
-			maxDots = std::max(maxDots, frame.dots.size());
+		for (size_t f = 0; f < frames.size(); ++f) {
+			maxDots = std::max(maxDots, frameView(f).dots.size());
 		}
-		if (maxDots > 0) {
+		if (!animated && dots.size() && style.compactDots) {
+			writeCompactDots(svg, style);
+		} else if (maxDots > 0) {
 			svg.tag("g");
 			static constexpr double outOfRange = -10000;
 			const char *neutralValue = "-10000";
@@ -1485,8 +4217,8 @@ public:
 				double x = outOfRange, y = outOfRange, r = 5, c = 0;
 				bool hasC = false;
 
-				if (d < dots.size() || (animated && dots.size() == 0 && d < frames[0].dots.size())) {
-					auto &dot = (dots.size() > 0) ? dots[d] : frames[0].dots[d];
+				if (d < dots.size() || (animated && dots.size() == 0 && d < frameView(0).dots.size())) {
+					auto &dot = (dots.size() > 0) ? dots[d] : frameView(0).dots[d];
 					x = axisX.map(dot.x);
 					y = axisY.map(dot.y);
 					r = dot.screenR;
@@ -1512,7 +4244,8 @@ public:
 					} else {
 						// write colour if *any* of the frames has a colour
 						bool animateC = hasC;
-						for (auto &frame : frames) {
+						for (size_t f = 0; f < frames.size(); ++f) {
+							auto frame = frameView(f);
 							if (d && frame.dots.size() && frame.dots[d].hasColour) {
 								animateC = true;
 							}
@@ -1523,9 +4256,9 @@ public:
 								.attr("attributeName", "cx");
 							writeAnimationAttrs(svg, [&](int index) {
 								double x = outOfRange;
-								if (d < frames[index].dots.size()) {
-									auto &dot = frames[index].dots[d];
-									if (dot.screenR > 0) x = axisX.map(frames[index].dots[d].x);
+								if (d < frameView(index).dots.size()) {
+									auto &dot = frameView(index).dots[d];
+									if (dot.screenR > 0) x = axisX.map(frameView(index).dots[d].x);
 								}
 								svg.raw(x);
 							}, neutralValue);
@@ -1534,8 +4267,8 @@ public:
 								.attr("attributeName", "cy");
 							writeAnimationAttrs(svg, [&](int index) {
 								double y = outOfRange;
-								if (d < frames[index].dots.size()) {
-									auto &dot = frames[index].dots[d];
+								if (d < frameView(index).dots.size()) {
+									auto &dot = frameView(index).dots[d];
 									if (dot.screenR > 0) y = axisY.map(dot.y);
 								}
 								svg.raw(y);
@@ -1545,12 +4278,12 @@ public:
 								.attr("attributeName", "r");
 							writeAnimationAttrs(svg, [&](int index) {
 								double r = 0;
-								if (d < frames[index].dots.size()) {
-									auto &dot = frames[index].dots[d];
+								if (d < frameView(index).dots.size()) {
+									auto &dot = frameView(index).dots[d];
 									if (dot.screenR > 0) r = dot.screenR;
 								}
 								svg.raw(r);
-							}, 0);
+							}, "0");
 							svg.raw("\"/>");
 							if (animateC) {
 								svg.raw("<animate").attr("calcMode", "discrete")
@@ -1558,8 +4291,8 @@ public:
 								const char *defaultColour = (styleIndex.colour < 0 || !style.colours.size()) ? "#000" : style.colours[styleIndex.colour%style.colours.size()].c_str();
 								writeAnimationAttrs(svg, [&](int index) {
 									const char *cstr = defaultColour;
-									if (d < frames[index].dots.size()) {
-										auto &dot = frames[index].dots[d];
+									if (d < frameView(index).dots.size()) {
+										auto &dot = frameView(index).dots[d];
 										if (dot.screenR > 0 && dot.hasColour) {
 											double c = 0.5 + (dot.c - 0.5)*style.dotCmapDepth;
 											svg.translateCmap(style, c);
@@ -1615,6 +4348,11 @@ class Legend : public SvgFileDrawable {
 		bool stroke, fill, marker;
 	};
 	std::vector<Entry> entries;
+protected:
+	// Positioned relative to the plot's bounds
+	bool layoutDependsOnParent() const override {
+		return true;
+	}
 public:
 	Legend(SvgFileDrawable &ref, Bounds dataBounds, double rx, double ry) : ref(ref), dataBounds(dataBounds), rx(rx), ry(ry) {}
 	
@@ -1641,17 +4379,18 @@ public:
 		if (ry > 1) topLeft.y += (refBounds.top - height - topLeft.y)*(ry - 1);
 		this->bounds = location = {topLeft.x, topLeft.x + width, topLeft.y, topLeft.y + height};
 		
-		for (size_t i = 0; i < entries.size(); ++i) {
+		for (size_t i = 0; isLayoutDirty() && i < entries.size(); ++i) {
 			auto &entry = entries[i];
 			double labelX = topLeft.x + style.textPadding*2 + exampleLineWidth;
 			double labelY = location.top + style.textPadding + (i + 0.5)*style.labelSize*style.lineHeight;
-			auto *label = new TextLabel({labelX, labelY}, 1, entry.name, "svg-plot-label svg-plot-l" + std::to_string(i), false, false);
+			auto *label = this->create<TextLabel>(Point2D{labelX, labelY}, 1, entry.name, "svg-plot-label svg-plot-l" + std::to_string(i), false, false);
 			this->addLayoutChild(label);
 		}
 		SvgFileDrawable::layout(style);
 	}
 	Legend & add(PlotStyle::Counter style, std::string name, bool stroke=true, bool fill=false, bool marker=false) {
 		entries.push_back(Entry{style, name, stroke, fill, marker});
+		markLayoutDirty();
 		return *this;
 	}
 	Legend & add(const Line2D &line2D, std::string name, bool stroke=true, bool fill=false, bool marker=false) {
@@ -1695,7 +4434,7 @@ public:
 			}
 			if (entry.marker) {
 				svg.tag("use", true)
-					.attr("href", "#", style.markerId(entry.style))
+					.attr("href", svg.defsHref, "#", style.markerId(entry.style))
 					.attr("class", style.fillClass(entry.style), " ", style.strokeClass(entry.style), " svg-plot-l", std::to_string(i))
 					.attr("transform", "translate(", (lineX1 + lineX2)/2, " ", lineY, ")");
 			}
@@ -1734,18 +4473,40 @@ class Plot2D : public SvgFileDrawable {
 	double titleRx = 0.0, titleRy = 0.0;
 	std::vector<std::unique_ptr<Axis>> xAxes, yAxes;
 	Bounds size;
+	/// What the layout was based on, for each axis
+	std::vector<Axis::LayoutState> layoutAxes;
+	std::vector<Axis::LayoutState> axisStates() const {
+		std::vector<Axis::LayoutState> states;
+		for (auto &x : xAxes) states.push_back(x->layoutState());
+		for (auto &y : yAxes) states.push_back(y->layoutState());
+		return states;
+	}
+protected:
+	bool layoutChanged() override {
+		if (layoutAxes.size() != xAxes.size() + yAxes.size()) return true;
+		size_t i = 0;
+		for (auto &x : xAxes) {
+			if (x->layoutState() != layoutAxes[i++]) return true;
+		}
+		for (auto &y : yAxes) {
+			if (y->layoutState() != layoutAxes[i++]) return true;
+		}
+		return false;
+	}
 public:
 	Axis &x, &y;
 	/// Creates an X axis, covering some portion of the left/right side
 	Axis & newX(double lowRatio=0, double highRatio=1) {
 		Axis *x = new Axis(size.left + lowRatio*size.width(), size.left + highRatio*size.width());
 		xAxes.emplace_back(x);
+		markLayoutDirty();
 		return *x;
 	}
 	/// Creates a Y axis, covering some portion of the bottom/top side
 	Axis & newY(double lowRatio=0, double highRatio=1) {
 		Axis *y = new Axis(size.bottom - lowRatio*size.height(), size.bottom - highRatio*size.height());
 		yAxes.emplace_back(y);
+		markLayoutDirty();
 		return *y;
 	}
 	/// Style for the next auto-styled element
@@ -1816,7 +4577,8 @@ public:
 		svg.raw("</g>");
 	}
 
-	void layout(const PlotStyle &style) override {
+	/// Auto-scales the axes, and creates the tick/axis/title labels
+	void layoutLabels(const PlotStyle &style) {
 		// Auto-scale axes if needed
 		for (auto &x : xAxes) x->autoSetup();
 		for (auto &y : yAxes) y->autoSetup();
@@ -1835,14 +4597,14 @@ public:
 			for (auto &t : x->tickList) {
 				double screenX = x->map(t.value);
 				if (t.name.size() && screenX >= xMin && screenX <= xMax) {
-					auto *label = new TextLabel({screenX, screenY}, 0, t.name, "svg-plot-value", false, true);
+					auto *label = this->create<TextLabel>(Point2D{screenX, screenY}, 0, t.name, "svg-plot-value", false, true);
 					this->addLayoutChild(label);
 				}
 			}
 			if (x->label().size()) {
 				double labelY = screenY + alignment*((style.labelSize + hasValues*style.valueSize)*0.5 + style.textPadding);
 				double midX = (x->drawMax() + x->drawMin())*0.5;
-				auto *label = new TextLabel({midX, labelY}, 0, x->label(), "svg-plot-label " + style.textClass(x->styleIndex), false, true);
+				auto *label = this->create<TextLabel>(Point2D{midX, labelY}, 0, x->label(), "svg-plot-label " + style.textClass(x->styleIndex), false, true);
 				this->addLayoutChild(label);
 			}
 		}
@@ -1854,7 +4616,7 @@ public:
 			for (auto &t : y->tickList) {
 				double screenY = y->map(t.value);
 				if (t.name.size() && screenY >= yMin && screenY <= yMax) {
-					auto *label = new TextLabel({screenX, screenY}, alignment, t.name, "svg-plot-value", false, true);
+					auto *label = this->create<TextLabel>(Point2D{screenX, screenY}, alignment, t.name, "svg-plot-value", false, true);
 					this->addLayoutChild(label);
 
 					double &longestLabel = y->flipped ? longestLabelRight : longestLabelLeft;
@@ -1869,7 +4631,7 @@ public:
 				double longestLabel = y->flipped ? longestLabelRight : longestLabelLeft;
 				double labelX = screenX + alignment*(style.textPadding*1.5 + longestLabel*style.valueSize);
 				double midY = (y->drawMax() + y->drawMin())*0.5;
-				auto *label = new TextLabel({labelX, midY}, 0, y->label(), "svg-plot-label " + style.textClass(y->styleIndex), true, true);
+				auto *label = this->create<TextLabel>(Point2D{labelX, midY}, 0, y->label(), "svg-plot-label " + style.textClass(y->styleIndex), true, true);
 				this->addLayoutChild(label);
 			}
 		}
@@ -1896,16 +4658,23 @@ public:
 			} else if (ry > 1) {
 				textY = dataInset.top + (dataOutset.top - dataInset.top)*(ry - 1);
 			}
-			auto *label = new TextLabel({textX, textY}, textAlignment, plotTitle, "svg-plot-title", false, 2);
+			auto *label = this->create<TextLabel>(Point2D{textX, textY}, textAlignment, plotTitle, "svg-plot-title", false, 2);
 			this->addLayoutChild(label);
 		}
+		layoutAxes = axisStates();
+	}
+
+	void layout(const PlotStyle &style) override {
+		// Labels are only rebuilt if something they depend on has changed, otherwise this just updates the bounds
+		if (isLayoutDirty()) layoutLabels(style);
 
+		double tv = std::max(style.tickV, 0.0), th = std::max(style.tickH, 0.0);
 		this->bounds = size.pad(th, tv);
 		SvgDrawable::layout(style);
 	};
 	
 	Line2D & line(Axis &x, Axis &y, PlotStyle::Counter styleIndex) {
-		Line2D *line = new Line2D(x, y, styleIndex);
+		Line2D *line = this->create<Line2D>(x, y, styleIndex);
 		this->addChild(line);
 		return *line;
 	}
@@ -1935,7 +4704,7 @@ public:
 	If `xRatio` and `yRatio` are in the range 0-1, the legend will be inside the plot.  Otherwise, it will move outside the plot (e.g. -1 will be left/below the axes, including any labels).
 	*/
 	Legend & legend(double xRatio, double yRatio) {
-		Legend *legend = new Legend(*this, size, xRatio, yRatio);
+		Legend *legend = this->create<Legend>(*this, size, xRatio, yRatio);
 		this->addChild(legend, true);
 		return *legend;
 	}
@@ -1943,7 +4712,7 @@ public:
 	/** Embeds an image using the given data co-ordinates
 		\image html embedded-image.svg */
 	Image & image(Axis &x, Axis &y, Bounds dataBounds, const std::string &url) {
-		Image *image = new Image(x, y, dataBounds, url);
+		Image *image = this->create<Image>(x, y, dataBounds, url);
 		this->addChild(image);
 		return *image;
 	}
@@ -1959,6 +4728,7 @@ public:
 		plotTitle = t;
 		titleRx = rx;
 		titleRy = ry;
+		markLayoutDirty();
 		return *this;
 	}
 };
@@ -1971,12 +4741,12 @@ protected:
 	}
 public:
 	Plot2D & plot(double widthPt, double heightPt) {
-		Plot2D *axes = new Plot2D({0, widthPt}, {heightPt, 0});
+		Plot2D *axes = this->create<Plot2D>(widthPt, heightPt);
 		this->addChild(axes);
 		return *axes;
 	}
 	Plot2D & plot() {
-		Plot2D *axes = new Plot2D();
+		Plot2D *axes = this->create<Plot2D>();
 		this->addChild(axes);
 		return *axes;
 	}
@@ -1988,14 +4758,20 @@ class Grid : public Cell {
 	int _colMax = 0, _colMin = 0, _rowMax = 0, _rowMin = 0;
 	struct Item {
 		int column, row;
-		std::unique_ptr<Grid> cell;
+		std::unique_ptr<Grid, SvgDrawable::Deleter> cell;
 		Point2D transpose = {0, 0};
-		Item(int column, int row) : column(column), row(row), cell(new Grid()) {}
+		Item(int column, int row, Grid *cell) : column(column), row(row), cell(cell) {}
 	};
-	std::vector<Item> items;
+	std::vector<Item> items; // in the order they were created, which is also the output order
+	std::unordered_map<uint64_t, size_t> itemIndex; // (column, row) -> index in `items`
+	int writeThreads = 1;
+
+	static uint64_t itemKey(int column, int row) {
+		return (uint64_t(uint32_t(column)) << 32) | uint32_t(row);
+	}
 
 	void writeItems(bool label, SvgWriter &svg, const PlotStyle &style) {
-		for (auto &it : items) {
+		auto writeItem = [&](Item &it, SvgWriter &svg) {
 			svg.tag("g").attr("transform", "translate(", it.transpose.x, " ", it.transpose.y, ")");
 			if (label) {
 				it.cell->writeLabel(svg, style);
@@ -2003,9 +4779,49 @@ class Grid : public Cell {
 				it.cell->writeData(svg, style);
 			}
 			svg.raw("</g>");
+		};
+		size_t threadCount = std::min(size_t(writeThreads), items.size());
+		if (threadCount <= 1) {
+			for (auto &it : items) writeItem(it, svg);
+			return;
+		}
+		// Each item gets its own buffer, and they're merged in order afterwards
+		std::vector<std::unique_ptr<SvgStringOutput>> outputs;
+		std::vector<std::unique_ptr<SvgWriter>> writers;
+		for (size_t i = 0; i < items.size(); ++i) {
+			outputs.emplace_back(new SvgStringOutput());
+			writers.emplace_back(new SvgWriter(*outputs[i], svg));
+		}
+		std::atomic<size_t> nextIndex(0);
+		auto writeNext = [&]() {
+			for (size_t i = nextIndex++; i < items.size(); i = nextIndex++) {
+				writeItem(items[i], *writers[i]);
+			}
+		};
+		std::vector<std::thread> threads;
+		for (size_t t = 1; t < threadCount; ++t) threads.emplace_back(writeNext);
+		writeNext();
+		for (auto &thread : threads) thread.join();
+		for (size_t i = 0; i < items.size(); ++i) {
+			svg.merge(outputs[i]->str(), *writers[i]);
 		}
 	}
 protected:
+	void resetLayout(size_t styleKey) override {
+		Cell::resetLayout(styleKey);
+		for (auto &it : items) it.cell->resetLayout(styleKey);
+	}
+	bool refreshLayout(size_t styleKey) override {
+		bool changed = Cell::refreshLayout(styleKey);
+		if (!isLayoutDirty()) {
+			// Only the changed cells are laid out again, but the positions of all of them are recalculated
+			for (auto &it : items) {
+				if (it.cell->refreshLayout(styleKey)) changed = true;
+			}
+			if (changed) invalidateBounds();
+		}
+		return changed;
+	}
 	void layout(const PlotStyle &style) override {
 		struct Range {
 			double min = 0, max = 0;
@@ -2051,6 +4867,13 @@ protected:
 		writeItems(true, svg, style);
 	}
 public:
+	/** Writes the cells on separate threads (`0` for one per core), producing the same output as writing them in sequence.
+		Drawables shared between cells (such as a `HeatMap` added to multiple plots) shouldn't be written in parallel. */
+	Grid & parallel(int threads=0) {
+		writeThreads = (threads > 0) ? threads : std::max(1, int(std::thread::hardware_concurrency()));
+		return *this;
+	}
+
 	int rows() const {
 		return _rowMax - _rowMin;
 	}
@@ -2062,12 +4885,11 @@ public:
 		_colMax = std::max(_colMax, column);
 		_rowMin = std::min(_rowMin, row);
 		_rowMax = std::max(_rowMax, row);
-		for (auto &it : items) {
-			if (it.row == row && it.column == column) {
-				return *it.cell;
-			}
-		}
-		items.emplace_back(column, row);
+		auto found = itemIndex.find(itemKey(column, row));
+		if (found != itemIndex.end()) return *items[found->second].cell;
+		itemIndex[itemKey(column, row)] = items.size();
+		items.emplace_back(column, row, this->create<Grid>());
+		adopt(items.back().cell.get());
 		return *(items.back().cell);
 	}
 
@@ -2089,10 +4911,16 @@ class Figure : public Grid {
 public:
 	PlotStyle style;
 	
-	Figure() : style(PlotStyle::defaultStyle()) {}
+	/// Elements in a figure are allocated from an arena, released when the figure is destroyed
+	Figure() : style(PlotStyle::defaultStyle()) {
+		useArena();
+	}
 
 	using Grid::write;
 
+	void write(SvgOutput &output) {
+		this->write(output, style);
+	}
 	void write(std::ostream &o) {
 		this->write(o, style);
 	}